@@ -33,9 +33,55 @@ document.addEventListener('DOMContentLoaded', () => {
     const stepsEl = document.getElementById('turn-by-turn-list');
     const optimizeCheckbox = document.getElementById('optimize-order-checkbox');
 
-    let buildingNames = [];
+    const SUGGESTION_LIMIT = 10;
+    // Route geometry is requested as an encoded polyline (1e-6 degrees)
+    const PATH_FORMAT = 'polyline6';
     let viaPointCounter = 0;
 
+    // Decode a Google encoded polyline into [[lat, lon], ...]
+    function decodePolyline(encoded, precision) {
+        const factor = Math.pow(10, precision);
+        const points = [];
+        let index = 0, lat = 0, lon = 0;
+        const nextDelta = () => {
+            let result = 0, shift = 0, byte;
+            do {
+                byte = encoded.charCodeAt(index++) - 63;
+                result |= (byte & 0x1f) << shift;
+                shift += 5;
+            } while (byte >= 0x20);
+            return (result & 1) ? ~(result >> 1) : (result >> 1);
+        };
+        while (index < encoded.length) {
+            lat += nextDelta();
+            lon += nextDelta();
+            points.push([lat / factor, lon / factor]);
+        }
+        return points;
+    }
+
+    // Decode base64 little-endian int32 (first point, then deltas, 1e-6 degrees)
+    function decodeDelta32(encoded) {
+        const bytes = Uint8Array.from(atob(encoded), c => c.charCodeAt(0));
+        const view = new DataView(bytes.buffer);
+        const points = [];
+        let lat = 0, lon = 0;
+        for (let offset = 0; offset + 8 <= bytes.length; offset += 8) {
+            lat += view.getInt32(offset, true);
+            lon += view.getInt32(offset + 4, true);
+            points.push([lat / 1e6, lon / 1e6]);
+        }
+        return points;
+    }
+
+    // Route geometry of a response, whichever format the backend used
+    function decodePath(data) {
+        if (data.path_format === 'polyline5') return decodePolyline(data.path, 5);
+        if (data.path_format === 'polyline6') return decodePolyline(data.path, 6);
+        if (data.path_format === 'delta32') return decodeDelta32(data.path);
+        return data.path_coordinates;
+    }
+
     // --- 3. Via Points Management ---
     
     function addViaPoint() {
@@ -82,30 +128,30 @@ document.addEventListener('DOMContentLoaded', () => {
     addViaBtn.addEventListener('click', addViaPoint);
 
     // --- 4. Autocomplete Feature ---
-    async function fetchBuildingList() {
+    async function fetchSuggestions(prefix) {
         try {
-            const response = await fetch('/api/buildings');
+            const response = await fetch(`/api/buildings?prefix=${encodeURIComponent(prefix)}&limit=${SUGGESTION_LIMIT}`);
             if (!response.ok) {
                 throw new Error('Failed to fetch building list');
             }
-            const data = await response.json();
-            buildingNames = data;
+            return await response.json();
         } catch (error) {
             console.error(error);
-            buildingNames = [];
+            return [];
         }
     }
 
     function setupAutocomplete(inputElement, listElement) {
-        inputElement.addEventListener('input', () => {
-            const value = inputElement.value.toLowerCase();
+        inputElement.addEventListener('input', async () => {
+            const value = inputElement.value.trim();
             listElement.innerHTML = '';
 
             if (!value) return;
 
-            const suggestions = buildingNames.filter(name =>
-                name.toLowerCase().startsWith(value)
-            );
+            const suggestions = await fetchSuggestions(value);
+            // drop answers to keystrokes that are already outdated
+            if (inputElement.value.trim() !== value) return;
+            listElement.innerHTML = '';
 
             suggestions.forEach(name => {
                 const item = document.createElement('div');
@@ -158,25 +204,15 @@ document.addEventListener('DOMContentLoaded', () => {
         try {
             const optimizeOrder = optimizeCheckbox.checked;
 
-            // Build API URL
-            let apiUrl;
-            
-            if (optimizeOrder) {
-                // TSP mode - send all buildings without order
-                apiUrl = `/api/navigate-tsp?`;
-                const allBuildings = [start, ...viaPoints, end];
-                allBuildings.forEach((building, index) => {
-                    apiUrl += `building${index + 1}=${encodeURIComponent(building)}`;
-                    if (index < allBuildings.length - 1) apiUrl += '&';
-                });
-            } else {
-                // Normal mode - maintain order
-                apiUrl = `/api/navigate?start=${encodeURIComponent(start)}`;
-                viaPoints.forEach(via => {
-                    apiUrl += `&via=${encodeURIComponent(via)}`;
-                });
-                apiUrl += `&end=${encodeURIComponent(end)}`;
-            }
+            // Build API URL - start and destination stay fixed,
+            // optimized mode lets the backend reorder the via points
+            let apiUrl = `/api/navigate?start=${encodeURIComponent(start)}`;
+            viaPoints.forEach(via => {
+                apiUrl += `&via=${encodeURIComponent(via)}`;
+            });
+            apiUrl += `&end=${encodeURIComponent(end)}`;
+            if (optimizeOrder) apiUrl += '&via_order=best';
+            apiUrl += `&format=${PATH_FORMAT}`;
 
             const response = await fetch(apiUrl);
             const data = await response.json();
@@ -186,6 +222,7 @@ document.addEventListener('DOMContentLoaded', () => {
             }
 
             // Handle the returned data
+            const pathCoordinates = decodePath(data);
             summaryEl.textContent = `Total Distance: ${data.total_distance.toFixed(1)} meters`;
 
             // Format instructions with numbered steps
@@ -197,7 +234,7 @@ document.addEventListener('DOMContentLoaded', () => {
             }).join('');
             stepsEl.innerHTML = instructionsHtml;
 
-            const pathPolyline = L.polyline(data.path_coordinates, {
+            const pathPolyline = L.polyline(pathCoordinates, {
                 color: '#0058a0',
                 weight: 6
             });
@@ -205,10 +242,8 @@ document.addEventListener('DOMContentLoaded', () => {
             // Create markers
             const markers = [];
             
-            // alert(data.path_coordinates)
-
             // Green marker for START
-            const startMarker = L.marker(data.path_coordinates[0], {
+            const startMarker = L.marker(pathCoordinates[0], {
                 title: 'Start',
                 icon: L.icon({
                     iconUrl: 'https://raw.githubusercontent.com/pointhi/leaflet-color-markers/master/img/marker-icon-2x-green.png',
@@ -226,8 +261,8 @@ document.addEventListener('DOMContentLoaded', () => {
             // Orange markers for VIA POINTS
             if (viaPoints.length > 0 && data.via_point_indices) {
                 data.via_point_indices.forEach((index, i) => {
-                    if (index >= 0 && index < data.path_coordinates.length) {
-                        const viaMarker = L.marker(data.path_coordinates[index], {
+                    if (index >= 0 && index < pathCoordinates.length) {
+                        const viaMarker = L.marker(pathCoordinates[index], {
                             title: `Via Point`,
                             icon: L.icon({
                                 iconUrl: 'https://raw.githubusercontent.com/pointhi/leaflet-color-markers/master/img/marker-icon-2x-orange.png',
@@ -237,14 +272,15 @@ document.addEventListener('DOMContentLoaded', () => {
                                 popupAnchor: [1, -34],
                                 shadowSize: [41, 41]
                             })
-                        }).bindPopup(`<b>Via Point:</b> ${viaPoints[i]}`);
+                        // reordered stops no longer line up with the inputs
+                        }).bindPopup(optimizeOrder ? `<b>Stop ${i + 1}</b>` : `<b>Via Point:</b> ${viaPoints[i]}`);
                         markers.push(viaMarker);
                     }
                 });
             }
 
             // Red marker for END
-            const endMarker = L.marker(data.path_coordinates[data.path_coordinates.length - 1], {
+            const endMarker = L.marker(pathCoordinates[pathCoordinates.length - 1], {
                 title: 'Destination',
                 icon: L.icon({
                     iconUrl: 'https://raw.githubusercontent.com/pointhi/leaflet-color-markers/master/img/marker-icon-2x-red.png',
@@ -270,7 +306,6 @@ document.addEventListener('DOMContentLoaded', () => {
     }
 
     // --- 6. Initial Setup ---
-    fetchBuildingList();
     setupAutocomplete(startInput, startList);
     setupAutocomplete(endInput, endList);
 });
\ No newline at end of file
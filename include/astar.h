@@ -2,6 +2,18 @@
 #define ASTAR_H
 
 #include "graph.h"
+
+// Point-to-point search signature shared by every search algorithm
+// Returns the path length (DBL_MAX if unreachable), path is malloc'd
+typedef double (*PathSearchFn)(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len);
+
 double astar(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len);
 
-#endif
\ No newline at end of file
+// Bidirectional A*: forward search from start and backward search from goal
+// over the reverse adjacency, using symmetric (average) haversine potentials
+double astar_bidirectional(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len);
+
+// Look up a search algorithm by name ("astar", "bidir", "ch", "alt"), NULL if unknown
+PathSearchFn find_search_algorithm(const char* name);
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stdio.h>
+#include "graph.h"
+
+// Output order of --batch results
+typedef enum {
+    BATCH_ORDER_INPUT, // results follow the input lines (default)
+    BATCH_ORDER_ANY    // each result is written as soon as it is ready
+} BatchOrder;
+
+// Name (input|any) -> order, returns -1 if unknown
+int batch_order_from_name(const char* name, BatchOrder* out);
+
+/**
+ * Answer a stream of queries with a pool of worker threads
+ *
+ * Input: one query per line, tab-separated arguments as for the daemon
+ *        (e.g. "Student Center\tTech Tower" or "--matrix\tA\tB\tC"); blank
+ *        lines are skipped.
+ * Output: one JSON line per query, {"id": <line number>, "response": {...}},
+ *         the response being exactly what bin/main prints, on one line.
+ *
+ * Each worker searches with its own per-thread workspace. With
+ * BATCH_ORDER_INPUT a worker does not run ahead of the oldest unwritten
+ * query by more than a fixed window, which bounds the buffered results.
+ *
+ * @param in           Query lines
+ * @param out          JSON lines
+ * @param num_workers  Worker threads (<= 0: one per core)
+ * @return number of queries answered, -1 on a write error
+ */
+long run_batch(Graph* campus, BuildingMapping* mapping, FILE* in, FILE* out,
+               int num_workers, BatchOrder order);
+
+#endif // BATCH_H
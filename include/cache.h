@@ -0,0 +1,66 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <stddef.h>
+#include "graph.h"
+#include "astar.h"
+
+// ========================
+// Thread-safe LRU cache of byte strings
+// Keys and values are copied in and out, so callers never hold pointers
+// into the cache. One omp_lock per cache guards a chained hash table plus
+// a recency list; the least recently used entries are evicted once the
+// stored bytes (keys, values and per-entry overhead) exceed the limit.
+// ========================
+
+// Defaults for the daemon (--cache-mb=<n> sets both, 0 disables)
+#define RESPONSE_CACHE_DEFAULT_BYTES (16u << 20)
+#define LEG_CACHE_DEFAULT_BYTES (16u << 20)
+
+typedef struct LruCache LruCache;
+
+typedef struct {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t entries;
+    size_t bytes;
+    size_t max_bytes;
+} LruStats;
+
+LruCache* lru_create(size_t max_bytes);
+void lru_free(LruCache* cache);
+
+/**
+ * Look up a key
+ *
+ * @param out        (Output) malloc'd copy of the value on a hit
+ * @param out_len    (Output) value length on a hit
+ * @return 1 on a hit, 0 on a miss
+ */
+int lru_get(LruCache* cache, const void* key, size_t key_len, void** out, size_t* out_len);
+
+// Insert or replace a key; values larger than the whole cache are not stored
+void lru_put(LruCache* cache, const void* key, size_t key_len, const void* value, size_t value_len);
+
+void lru_stats(LruCache* cache, LruStats* out);
+
+// ========================
+// Leg cache: point-to-point results shared by via routing and TSP
+// Keyed by (search function, start, goal); disabled until leg_cache_enable().
+// ========================
+
+void leg_cache_enable(size_t max_bytes);
+void leg_cache_disable(void);
+
+// Stats of the leg cache, returns 0 if it is disabled
+int leg_cache_stats(LruStats* out);
+
+/**
+ * search(graph, start_id, goal_id, ...) through the leg cache
+ * Same outputs as a PathSearchFn: malloc'd path, DBL_MAX if unreachable
+ */
+double cached_search(PathSearchFn search, Graph* graph, int start_id, int goal_id,
+                     int** out_path, int* out_len);
+
+#endif // CACHE_H
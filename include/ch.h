@@ -0,0 +1,50 @@
+#ifndef CH_H
+#define CH_H
+
+#include "graph.h"
+
+// ========================
+// Contraction Hierarchies
+// Nodes are contracted one by one (ordered by edge difference); shortcuts
+// keep the contracted middle node so query paths unpack to original nodes.
+// Every edge of the augmented graph is stored once, at its lower-ranked end.
+// ========================
+
+typedef struct CHGraph
+{
+    int num_nodes;
+    int source_edges; // num_edges of the graph it was built from (sanity check)
+    uint64_t source_checksum; // Graph.checksum of that graph
+    int *rank;        // contraction position of each node
+
+    // Upward edges u -> v with rank[v] > rank[u], stored at u
+    int *up_offsets;
+    int *up_targets;
+    double *up_weights;
+    int *up_middle; // contracted node the shortcut bypasses, -1 for an original edge
+
+    // Downward edges v -> u with rank[v] > rank[u], stored at u (walked backwards)
+    int *down_offsets;
+    int *down_sources;
+    double *down_weights;
+    int *down_middle;
+} CHGraph;
+
+// Offline preprocessing: contract every node of a frozen graph
+CHGraph *ch_build(const Graph *g);
+void ch_free(CHGraph *ch);
+
+// Save / load the hierarchy (binary, native byte order)
+// ch_read returns NULL if the file is missing, was built for another graph
+// (different checksum) or holds out-of-range sizes, offsets or node ids
+int ch_write(const char *filename, const CHGraph *ch);
+CHGraph *ch_read(const char *filename, const Graph *g);
+
+/**
+ * Bidirectional upward search on graph->ch, path unpacked to original nodes
+ * Same parameters and return value as astar(); falls back to
+ * astar_bidirectional() when no hierarchy is attached to the graph
+ */
+double ch_query(Graph *graph, int start_id, int goal_id, int **out_path, int *out_len);
+
+#endif // CH_H
@@ -1,31 +1,48 @@
 #ifndef GRAPH_H
 #define GRAPH_H
 
-#define MAX_BUILDINGS 400 // Building capacity
+#include <stddef.h>
+#include <stdint.h>
 
 // ========================
 // Graph Struct Definitions
-// Adjacency List Representation
+// Adjacency lists while building, frozen into
+// Compressed Sparse Row (CSR) arrays for searching
 // ========================
 
 typedef struct Edge
-{
+{ // Build-time edge, only lives until the graph is frozen
     int to;        // destination node
     double weight; // road length
     struct Edge *next;
 } Edge;
 
-typedef struct Node
-{ // Adjacency list node
-    int id;
-    double lat, lon;
-    Edge *neighbors; // point to the first edge of the linked list
-} Node;
-
 typedef struct Graph
 {
     int num_nodes;
-    Node *nodes; // array of nodes
+    int num_edges;
+    Edge **adjacency; // build-time linked lists, NULL once frozen
+
+    // CSR layout: out-edges of node u are [offsets[u], offsets[u + 1])
+    int *offsets;     // num_nodes + 1 entries
+    int *targets;     // destination node of each edge
+    double *weights;  // road length of each edge
+
+    // Reverse CSR: in-edges of node v are [rev_offsets[v], rev_offsets[v + 1])
+    int *rev_offsets;    // num_nodes + 1 entries
+    int *rev_sources;    // origin node of each in-edge
+    double *rev_weights; // road length of each in-edge
+
+    // Node coordinates, one array per field
+    double *lat;
+    double *lon;
+
+    uint64_t checksum; // graph_checksum() of the frozen arrays, set by the loader
+
+    // Optional speed-up structures, NULL unless loaded (owned by the loader)
+    struct CHGraph *ch;          // contraction hierarchy (ch.h)
+    struct Landmarks *landmarks; // ALT distance tables (landmarks.h)
+    struct EdgeGrid *edge_grid;  // road segments for coordinate snapping (spatial.h)
 } Graph;
 
 // ======================
@@ -33,6 +50,15 @@ typedef struct Graph
 // ======================
 Graph *create_graph(int num_nodes);
 void add_edge(Graph *g, int from, int to, double weight);
+void freeze_graph(Graph *g);
+
+// FNV-1a 64 over len bytes, continuing from hash (FNV_OFFSET for a new hash)
+#define FNV_OFFSET 1469598103934665603ULL
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len);
+
+// Hash of the offsets, targets and weights of a frozen graph; files derived
+// from a graph (the contraction hierarchy) store it to detect a changed graph
+uint64_t graph_checksum(const Graph *g);
 Graph *load_graph(const char *filename);
 void print_graph(const Graph *g);
 void free_graph(Graph *g);
@@ -47,14 +73,38 @@ typedef struct BuildingEntry
     int node_id;
 } BuildingEntry;
 
+// Lookup index over the entries, built once by index_buildings()
+typedef struct BuildingIndex
+{
+    int *slots;     // open-addressing name hash table of entry indices, -1 = empty
+    int num_slots;  // power of two, at least twice the entry count
+    int *by_node;   // node id -> entry index, -1 if the node is no building
+    int num_nodes;  // length of by_node (largest building node id + 1)
+    int *sorted;    // entry indices ordered by case-insensitive name, for prefix search
+} BuildingIndex;
+
 typedef struct BuildingMapping
 {
     BuildingEntry *entries;
     int count;
     int capacity;
+    BuildingIndex index;
+    struct SpatialGrid *grid; // entries by location (spatial.h), NULL unless attached by the loader
 } BuildingMapping;
 
 BuildingMapping *load_building(const char *filename);
 int get_building_id(const BuildingMapping *mapping, const char *name);
 void free_building(BuildingMapping *mapping);
+
+// (Re)build the lookup index; load_building and open_snapshot call it
+void index_buildings(BuildingMapping *mapping);
+void free_building_index(BuildingMapping *mapping);
+
+// Building entry at node_id, -1 if none
+int get_building_at_node(const BuildingMapping *mapping, int node_id);
+
+// Up to max_results entry indices whose name starts with prefix (case-insensitive),
+// in name order; returns how many were written
+int find_buildings_by_prefix(const BuildingMapping *mapping, const char *prefix,
+                             int max_results, int *out_entries);
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef HANDLERS_H
+#define HANDLERS_H
+
+#include <stdio.h>
+#include "graph.h"
+#include "astar.h"
+#include "tsp.h"
+#include "utils.h"
+#include "stats.h"
+
+// Per-query options, given as "--name=value" arguments anywhere in the query
+typedef struct {
+    PathSearchFn search; // --algo=astar|bidir|ch|alt, point-to-point search for every leg
+    TspOptions tsp;      // --tsp-solver=auto|exact|heuristic, --tsp-budget=<ms>,
+                         // --tsp-mode=open|start|start-end|round-trip
+    int reorder_via;     // --via-order=given|best, reorder navigate via points (start / end stay)
+    int limit;           // --limit=<n>, most names --buildings returns (0 = all)
+    PathFormat format;   // --format=json|polyline5|polyline6|delta32, route geometry encoding
+    int stats;           // --stats=on|off, add a "stats" object to route responses (make STATS=1)
+    QueryStats stats_base; // counters when the query started, set by dispatch_request
+} QueryOptions;
+
+// Consolidate resource loading (graph, coordinates, building mapping)
+// Uses ../data/campus.snapshot when present, otherwise parses the CSV files
+// Returns 1 on success, 0 on failure
+int load_campus_resources(Graph** campus, BuildingMapping** mapping);
+
+// Release whatever load_campus_resources loaded
+void free_campus_resources(Graph* campus, BuildingMapping* mapping);
+
+// --tsp <b1> <b2> ... : optimal visiting order over all buildings (b1 / last one fixed per --tsp-mode)
+void handle_tsp_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                     const QueryOptions* opts, int argc, char *argv[]);
+
+// --matrix <b1> <b2> ... : shortest distances between every pair of buildings
+void handle_matrix_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                        const QueryOptions* opts, int argc, char *argv[]);
+
+// --buildings [prefix] : building names starting with prefix (case-insensitive), in name order
+void handle_buildings_mode(FILE* out, BuildingMapping* mapping,
+                           const QueryOptions* opts, int argc, char *argv[]);
+
+// --from-coord <lat,lon> --to-coord <lat,lon> : route between two coordinates snapped to the nearest roads
+void handle_coord_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                       const QueryOptions* opts, int argc, char *argv[]);
+
+// <start> [via...] <end> : A* route through the given via points
+void handle_navigation_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                            const QueryOptions* opts, int argc, char *argv[]);
+
+// --cache-stats : hit / miss counters of the response and leg caches
+// --stats-summary : instrumentation totals of every request served (make STATS=1)
+
+/**
+ * Cache rendered responses of successful queries and point-to-point legs
+ * (see cache.h); a size of 0 leaves that cache off. Call before serving.
+ */
+void handlers_enable_cache(size_t response_bytes, size_t leg_bytes);
+void handlers_disable_cache(void);
+
+// Most arguments one query line may carry (program name included)
+#define MAX_QUERY_ARGS 256
+
+// Split a query line on tabs into an argv-style array (argv[0] = program name),
+// used by the daemon and batch mode; returns argc
+int split_query_line(char* line, char* argv[], int max_args);
+
+/**
+ * Dispatch one query to the matching handler and write its JSON response
+ *
+ * @param out       Stream receiving the JSON response
+ * @param argc      Argument count, argv[0] is the program name
+ * @param argv      Query arguments, same layout as the command line,
+ *                  "--name=value" options are removed before dispatch
+ * @return 0 if a handler ran, 1 on a usage error
+ */
+int dispatch_request(FILE* out, Graph* campus, BuildingMapping* mapping, int argc, char *argv[]);
+
+#endif // HANDLERS_H
@@ -0,0 +1,90 @@
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+#include <float.h>
+
+// ========================
+// Indexed priority queue over node ids
+// Every node is queued at most once: pushing a queued node lowers its key
+// (decrease-key), so there are no stale entries and the size never
+// exceeds the number of nodes.
+//
+// HEAP_DARY  : 4-ary heap, any key order (default)
+// HEAP_RADIX : radix heap for monotone searches (Dijkstra, consistent A*).
+//              Keys are bucketed by their IEEE bit pattern, so they need no
+//              quantization; a key below the last popped one is clamped up to it.
+//
+// Default kind: compile time with -DHEAP_DEFAULT_KIND=HEAP_RADIX (make HEAP=radix),
+// run time with heap_set_default_kind() (--heap=dary|radix)
+// ========================
+
+typedef enum {
+    HEAP_DARY = 0,
+    HEAP_RADIX = 1
+} HeapKind;
+
+#ifndef HEAP_DEFAULT_KIND
+#define HEAP_DEFAULT_KIND HEAP_DARY
+#endif
+
+#define RADIX_BUCKETS 65
+
+typedef struct {
+    int node_id;
+    double key;
+} HeapItem;
+
+typedef struct {
+    int* items;
+    int count;
+    int cap;
+} RadixBucket;
+
+typedef struct {
+    HeapKind kind;
+    int capacity;          // node ids must be below capacity
+    int size;
+    int* pos;              // slot of each queued node, -1 when not queued
+
+    // HEAP_DARY
+    HeapItem* items;       // heap order
+
+    // HEAP_RADIX
+    double* key;           // key of each queued node
+    uint64_t* bits;        // order-preserving integer image of key
+    unsigned char* bucket; // bucket holding each queued node
+    uint64_t last;         // image of the last popped key
+    RadixBucket buckets[RADIX_BUCKETS];
+} PQueue;
+
+void pq_init(PQueue* pq, int capacity, HeapKind kind);
+void pq_free(PQueue* pq);
+
+// Empty the queue in O(size)
+void pq_clear(PQueue* pq);
+
+// Insert v, or lower its key if already queued; returns 0 if key did not improve
+int pq_push(PQueue* pq, int v, double key);
+
+// Remove the node with the smallest key; its key goes to *key if not NULL
+int pq_pop(PQueue* pq, double* key);
+
+// Smallest key, DBL_MAX when empty
+double pq_min_key(PQueue* pq);
+
+static inline int pq_empty(const PQueue* pq) {
+    return pq->size == 0;
+}
+
+static inline int pq_contains(const PQueue* pq, int v) {
+    return pq->pos[v] != -1;
+}
+
+HeapKind heap_default_kind(void);
+void heap_set_default_kind(HeapKind kind);
+
+// "dary" / "radix"; returns 0 on success, -1 for an unknown name
+int heap_kind_from_name(const char* name, HeapKind* kind);
+
+#endif // HEAP_H
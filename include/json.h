@@ -0,0 +1,73 @@
+#ifndef JSON_H
+#define JSON_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+// ========================
+// Growable JSON output buffer
+// Responses are assembled in memory and handed to the stream in one write,
+// instead of one stdio call per token. Numbers are formatted without
+// printf and strings are always escaped.
+// ========================
+
+typedef struct {
+    char* data;
+    size_t len;
+    size_t cap;
+} JsonBuf;
+
+// This thread's buffer, emptied; it keeps its memory between responses
+JsonBuf* json_thread_buffer(void);
+
+// Make room for n more bytes
+void json_buf_reserve(JsonBuf* b, size_t n);
+
+void json_buf_append(JsonBuf* b, const char* s, size_t n);
+
+// Append a string literal
+#define json_buf_literal(b, lit) json_buf_append((b), (lit), sizeof(lit) - 1)
+
+static inline void json_buf_char(JsonBuf* b, char c) {
+    if (b->len + 1 > b->cap) json_buf_reserve(b, 1);
+    b->data[b->len++] = c;
+}
+
+// Append s as a quoted, escaped JSON string
+void json_buf_string(JsonBuf* b, const char* s);
+
+void json_buf_int(JsonBuf* b, long long v);
+
+/**
+ * Append v with a fixed number of decimals
+ * Produces the same digits as printf("%.*f", decimals, v)
+ *
+ * @param decimals  0..9
+ */
+void json_buf_fixed(JsonBuf* b, double v, int decimals);
+
+/**
+ * Append a coordinate list as a quoted Google encoded polyline
+ * Points are rounded to 10^-precision degrees, then each coordinate is the
+ * zigzag varint (5-bit groups + 63) of its delta to the previous point.
+ *
+ * @param precision  5 (the Google default) or 6
+ */
+void json_buf_polyline(JsonBuf* b, const double* lat, const double* lon, int n, int precision);
+
+/**
+ * Append a coordinate list as a quoted base64 string of little-endian int32:
+ * lat, lon of the first point in 10^-6 degrees, then lat, lon deltas
+ */
+void json_buf_delta32(JsonBuf* b, const double* lat, const double* lon, int n);
+
+/**
+ * Send the buffer to a stream in one go
+ * Streams backed by a file descriptor are flushed and written with write(),
+ * others (memory streams) get a single fwrite().
+ *
+ * @return 0 on success, -1 on a write error
+ */
+int json_buf_write(const JsonBuf* b, FILE* out);
+
+#endif // JSON_H
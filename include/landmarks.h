@@ -0,0 +1,40 @@
+#ifndef LANDMARKS_H
+#define LANDMARKS_H
+
+#include "graph.h"
+
+#define ALT_DEFAULT_LANDMARKS 8
+
+// ========================
+// ALT: A*, Landmarks, Triangle inequality
+// For every landmark L the distances d(L, v) and d(v, L) give lower bounds
+//     d(v, t) >= d(L, t) - d(L, v)   and   d(v, t) >= d(v, L) - d(t, L)
+// Tables are node-major floats (INFINITY = unreachable).
+// ========================
+
+typedef struct Landmarks
+{
+    int count;
+    int num_nodes;
+    int *nodes;  // landmark node ids
+    float *from; // from[v * count + l] = d(landmark l, v)
+    float *to;   // to[v * count + l]   = d(v, landmark l)
+} Landmarks;
+
+// Pick landmarks by farthest-point selection and compute their tables
+Landmarks *landmarks_build(const Graph *g, int count);
+
+// Recompute the tables for the same landmarks after edge weights changed
+void landmarks_update(Landmarks *lm, const Graph *g);
+
+void landmarks_free(Landmarks *lm);
+
+/**
+ * A* with the landmark lower bound (max with haversine) on graph->landmarks
+ * The first call builds ALT_DEFAULT_LANDMARKS landmarks into graph->landmarks
+ * (other threads wait for it); the owner frees them with landmarks_free().
+ * Same parameters and return value as astar(); plain astar() without landmarks
+ */
+double astar_alt(Graph *graph, int start_id, int goal_id, int **out_path, int *out_len);
+
+#endif // LANDMARKS_H
@@ -0,0 +1,64 @@
+#ifndef LOGGING_H
+#define LOGGING_H
+
+// ========================
+// Structured logging
+// Every thread appends records to its own lock-free ring buffer; a
+// background thread drains the rings to stderr or a file as JSON lines:
+//   {"ts": 1718000000.123456, "level": "info", "thread": 2, "msg": "..."}
+// A search thread never waits: the record is formatted into its ring and,
+// when the ring is full, dropped and counted instead.
+//
+// Levels below LOG_COMPILE_LEVEL (make LOG_LEVEL=warn) are compiled out,
+// levels below the run-time level (--log-level=...) cost one comparison.
+// Processes that never call log_init (the tools) print "[level] message"
+// lines to stderr directly.
+// ========================
+
+typedef enum {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARN,
+    LOG_LEVEL_ERROR,
+    LOG_LEVEL_OFF
+} LogLevel;
+
+#ifndef LOG_COMPILE_LEVEL
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+// Records per thread ring and longest message kept (longer ones are cut)
+#define LOG_RING_SLOTS 256
+#define LOG_MESSAGE_MAX 240
+
+// Run-time threshold, set by log_init
+extern LogLevel log_runtime_level;
+
+// Name (debug|info|warn|error|off) -> level, returns -1 if unknown
+int log_level_from_name(const char* name, LogLevel* out);
+
+/**
+ * Start the drain thread
+ *
+ * @param path   JSON-lines file to append to, NULL for stderr
+ * @param level  Records below this level are skipped
+ * @return 0 on success, -1 if the file or the thread could not be created
+ */
+int log_init(const char* path, LogLevel level);
+
+// Stop the drain thread after writing every pending record
+void log_shutdown(void);
+
+void log_write(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define LOG_ENABLED(level) ((level) >= LOG_COMPILE_LEVEL && (level) >= log_runtime_level)
+
+#define LOG_AT(level, ...) \
+    do { if (LOG_ENABLED(level)) log_write((level), __VA_ARGS__); } while (0)
+
+#define LOG_DEBUG(...) LOG_AT(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(LOG_LEVEL_INFO, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(LOG_LEVEL_WARN, __VA_ARGS__)
+#define LOG_ERROR(...) LOG_AT(LOG_LEVEL_ERROR, __VA_ARGS__)
+
+#endif // LOGGING_H
@@ -0,0 +1,56 @@
+#ifndef MATRIX_H
+#define MATRIX_H
+
+#include "graph.h"
+
+// ========================
+// Many-to-many distances (no paths)
+// With a hierarchy attached (graph->ch) every target runs one backward
+// upward search that drops (target, distance) entries into buckets at the
+// nodes it settles; every source then runs one forward upward search and
+// scans the buckets it meets. Without one, every source runs a Dijkstra
+// that stops once all targets are settled.
+// ========================
+
+/**
+ * Distances from one source to a set of targets
+ * Dijkstra that stops as soon as every target is settled or the next node
+ * lies beyond max_dist; runs in the calling thread's SearchContext
+ *
+ * @param graph        Pointer to graph
+ * @param source       Source node ID
+ * @param targets      Target node IDs (duplicates allowed)
+ * @param num_targets  Number of targets
+ * @param max_dist     Distance bound, DBL_MAX for none
+ * @param out_dist     (Output) num_targets distances, DBL_MAX if unreachable or beyond max_dist
+ * @return number of targets within max_dist
+ */
+int dijkstra_one_to_many(Graph* graph, int source, const int* targets, int num_targets,
+                         double max_dist, double* out_dist);
+
+/**
+ * dijkstra_one_to_many() for several sources at once
+ * Sources are spread over the OpenMP threads, each reusing its own SearchContext
+ *
+ * @param out_dist  (Output) row-major num_sources x num_targets distances
+ */
+void dijkstra_one_to_many_batch(Graph* graph, const int* sources, int num_sources,
+                                const int* targets, int num_targets, double max_dist,
+                                double* out_dist);
+
+/**
+ * Shortest-path distance from every source to every target
+ * Rows are computed in parallel with OpenMP
+ *
+ * @param graph        Pointer to graph
+ * @param sources      Source node IDs
+ * @param num_sources  Number of sources
+ * @param targets      Target node IDs
+ * @param num_targets  Number of targets
+ * @return malloc'd row-major num_sources x num_targets matrix,
+ *         DBL_MAX where the target is unreachable
+ */
+double* distance_matrix(Graph* graph, const int* sources, int num_sources,
+                        const int* targets, int num_targets);
+
+#endif // MATRIX_H
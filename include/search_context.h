@@ -0,0 +1,94 @@
+#ifndef SEARCH_CONTEXT_H
+#define SEARCH_CONTEXT_H
+
+#include <float.h>
+#include "graph.h"
+#include "heap.h"
+#include "stats.h"
+
+// ========================
+// Reusable search workspace
+// One context per thread holds every per-node array a search needs.
+// Entries are only valid when their stamp equals the context generation,
+// so starting a new search is a single increment instead of an O(n) fill.
+// ========================
+
+// Labels of one search direction
+typedef struct {
+    double* dist;
+    int* parent;         // previous node in the search tree, -1 at the root
+    int* parent_edge;    // edge used to reach the node (meaning is up to the search)
+    unsigned* stamp;     // dist/parent/parent_edge valid iff stamp == generation
+    unsigned* closed;    // settled iff closed == generation
+    PQueue heap;         // indexed: a node is queued at most once
+} SearchSide;
+
+typedef struct SearchContext {
+    int capacity;        // number of nodes the arrays hold
+    HeapKind heap_kind;
+    unsigned generation;
+    SearchSide side[2];  // forward / backward
+    double* value;       // per-node cached value (heuristic, potential)
+    unsigned* value_stamp;
+    unsigned long long settled;          // nodes settled by every search run on this context
+    struct SearchContext* next_context;  // list of all live contexts (settled totals)
+} SearchContext;
+
+SearchContext* search_context_create(int capacity);
+void search_context_free(SearchContext* ctx);
+
+// Calling thread's context, grown to fit graph (and rebuilt if the default heap kind changed); lives as long as the thread
+SearchContext* search_context_acquire(const Graph* graph);
+
+// Start a new search: O(1) invalidation of every label
+void search_context_begin(SearchContext* ctx);
+
+// Nodes settled so far by all searches in every thread; exact only while no search is running
+unsigned long long search_settled_total(void);
+
+static inline double sc_dist(const SearchContext* ctx, int side, int v) {
+    const SearchSide* s = &ctx->side[side];
+    return s->stamp[v] == ctx->generation ? s->dist[v] : DBL_MAX;
+}
+
+static inline int sc_parent(const SearchContext* ctx, int side, int v) {
+    const SearchSide* s = &ctx->side[side];
+    return s->stamp[v] == ctx->generation ? s->parent[v] : -1;
+}
+
+static inline void sc_set(SearchContext* ctx, int side, int v, double dist, int parent, int parent_edge) {
+    SearchSide* s = &ctx->side[side];
+    s->stamp[v] = ctx->generation;
+    s->dist[v] = dist;
+    s->parent[v] = parent;
+    s->parent_edge[v] = parent_edge;
+}
+
+static inline int sc_closed(const SearchContext* ctx, int side, int v) {
+    return ctx->side[side].closed[v] == ctx->generation;
+}
+
+// Count one node taken off the queue for good
+static inline void sc_settled(SearchContext* ctx) {
+    ctx->settled++;
+    STAT_ADD(STAT_NODES_SETTLED, 1);
+}
+
+static inline void sc_close(SearchContext* ctx, int side, int v) {
+    ctx->side[side].closed[v] = ctx->generation;
+    sc_settled(ctx);
+}
+
+static inline int sc_has_value(const SearchContext* ctx, int v) {
+    return ctx->value_stamp[v] == ctx->generation;
+}
+
+static inline void sc_set_value(SearchContext* ctx, int v, double value) {
+    ctx->value_stamp[v] = ctx->generation;
+    ctx->value[v] = value;
+}
+
+// malloc'd path along the parents of v: side 0 gives root .. v, side 1 gives v .. root
+int* sc_build_path(const SearchContext* ctx, int side, int v, int* out_len);
+
+#endif // SEARCH_CONTEXT_H
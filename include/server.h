@@ -0,0 +1,27 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "graph.h"
+
+#define DEFAULT_SOCKET_PATH "/tmp/buzznav.sock"
+
+/**
+ * Persistent routing daemon
+ *
+ * Listens on a Unix domain socket and answers queries against the
+ * already-loaded graph until SIGINT/SIGTERM.
+ *
+ * Protocol (one query per line, several queries per connection allowed):
+ *   request:  tab-separated arguments, same layout as the command line
+ *             e.g. "Student Center\tTech Tower" or "--tsp\tA\tB\tC"
+ *   response: "<length>\n" followed by <length> bytes of JSON
+ *
+ * @param campus        Loaded campus graph (shared read-only by workers)
+ * @param mapping       Loaded building mapping (shared read-only by workers)
+ * @param socket_path   Filesystem path of the socket to create
+ * @param num_workers   Worker threads accepting connections (<= 0: one per core)
+ * @return 0 on clean shutdown, -1 if the socket could not be set up
+ */
+int run_server(Graph* campus, BuildingMapping* mapping, const char* socket_path, int num_workers);
+
+#endif // SERVER_H
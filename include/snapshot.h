@@ -0,0 +1,68 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "graph.h"
+
+// ========================
+// Binary Graph Snapshot
+// A frozen CSR graph, node coordinates and the building table in one
+// file that is mmap'd read-only, so startup does no parsing at all.
+//
+// Layout (native byte order, every section 8-byte aligned):
+//   SnapshotHeader
+//   double   weights[num_edges]
+//   double   rev_weights[num_edges]
+//   double   lat[num_nodes]
+//   double   lon[num_nodes]
+//   int32_t  offsets[num_nodes + 1]
+//   int32_t  targets[num_edges]
+//   int32_t  rev_offsets[num_nodes + 1]
+//   int32_t  rev_sources[num_edges]
+//   int32_t  building_nodes[num_buildings]
+//   uint32_t name_offsets[num_buildings]   (into the names block)
+//   char     names[names_bytes]            (NUL-terminated strings)
+// ========================
+
+#define SNAPSHOT_MAGIC "BUZZNAV"
+#define SNAPSHOT_VERSION 3
+
+typedef struct SnapshotHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t num_nodes;
+    uint32_t num_edges;
+    uint32_t num_buildings;
+    uint64_t names_bytes;
+    uint64_t payload_bytes;  // everything after the header
+    uint64_t checksum;       // FNV-1a 64 over the payload
+    uint64_t graph_checksum; // graph_checksum() of the stored graph
+} SnapshotHeader;
+
+typedef struct Snapshot
+{
+    void *base; // start of the read-only mapping
+    size_t size;
+    Graph graph;             // arrays point into the mapping
+    BuildingMapping mapping; // names point into the mapping
+} Snapshot;
+
+// Write a frozen graph and its building table as a snapshot file
+// Returns 0 on success, -1 on error
+int write_snapshot(const char *filename, const Graph *g, const BuildingMapping *mapping);
+
+// Map a snapshot file and validate its magic, version and size
+// The payload is not read here (see verify_snapshot), so opening costs no page faults
+// Returns NULL if the file is missing, truncated or not a snapshot of this version
+Snapshot *open_snapshot(const char *filename);
+
+// Recompute the payload checksum (reads the whole file)
+// Returns 0 if it matches the header, -1 otherwise
+int verify_snapshot(const Snapshot *snap);
+
+// Unmap the snapshot (graph and mapping become invalid)
+void close_snapshot(Snapshot *snap);
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,109 @@
+#ifndef SPATIAL_H
+#define SPATIAL_H
+
+#include "graph.h"
+
+// ========================
+// Static uniform grid over points
+// Coordinates are projected once (equirectangular around the centre of the
+// points, meters) and bucketed into square cells stored CSR-style, so a
+// query only visits the cells around it and never calls trig per point.
+// Items are numbered 0..num_items-1 in the order they were given.
+// ========================
+
+typedef struct SpatialGrid
+{
+    int num_items;
+    double lat0, lon0;       // projection centre (degrees)
+    double m_per_deg_lat;    // meters per degree of latitude / longitude at lat0
+    double m_per_deg_lon;
+    double min_x, min_y;     // projected corner of cell (0, 0)
+    double cell_size;        // meters
+    int cols, rows;
+    int *cell_offsets;       // items of cell c are [cell_offsets[c], cell_offsets[c + 1])
+    int *items;              // item ids, grouped by cell
+    double *x, *y;           // projected coordinates, same order as items
+} SpatialGrid;
+
+/**
+ * Build a grid over num_items points
+ *
+ * @param lat        Latitude of every item
+ * @param lon        Longitude of every item
+ * @param num_items  Number of items
+ * @param cell_size  Cell edge in meters, <= 0 picks one for about two items per cell
+ * @return grid, free with spatial_grid_free()
+ */
+SpatialGrid *spatial_grid_build(const double *lat, const double *lon, int num_items, double cell_size);
+
+// Grid over building entries (item = entry index), placed at their nodes
+SpatialGrid *spatial_grid_for_buildings(const Graph *g, const BuildingMapping *mapping);
+
+void spatial_grid_free(SpatialGrid *grid);
+
+/**
+ * Nearest item to a coordinate
+ *
+ * @param max_dist  Ignore items farther than this (meters, DBL_MAX for none)
+ * @param out_dist  (Output, may be NULL) distance in meters
+ * @return item id, -1 if none lies within max_dist
+ */
+int spatial_nearest(const SpatialGrid *grid, double lat, double lon, double max_dist, double *out_dist);
+
+/**
+ * Every item within radius meters of a coordinate, in no particular order
+ *
+ * @param out_items  (Output) first max_items matches
+ * @return number of matches (can exceed max_items)
+ */
+int spatial_radius(const SpatialGrid *grid, double lat, double lon, double radius,
+                   int *out_items, int max_items);
+
+// ========================
+// Road segments for coordinate snapping
+// Same cells as above, but a segment is listed in every cell its bounding box
+// touches; one segment per road (two-way roads once, one-way roads in edge
+// direction).
+// ========================
+
+// Coordinates farther than this from every road are rejected (meters)
+#define SNAP_MAX_DISTANCE 500.0
+
+typedef struct EdgeGrid
+{
+    SpatialGrid grid;  // cell lists of segment ids (grid.x / grid.y unused)
+    int num_segments;
+    int *seg_from;     // end nodes of every segment
+    int *seg_to;
+} EdgeGrid;
+
+// Closest point of the road network to a coordinate
+typedef struct
+{
+    int from, to;      // segment end nodes
+    double t;          // position along from -> to, 0..1
+    double lat, lon;   // snapped coordinate
+    double dist;       // meters from the query coordinate
+} EdgeSnap;
+
+EdgeGrid *edge_grid_build(const Graph *g);
+void edge_grid_free(EdgeGrid *eg);
+
+/**
+ * Snap a coordinate to the nearest road segment
+ *
+ * @param max_dist  Ignore segments farther than this (meters, DBL_MAX for none)
+ * @param out       (Output) snapped position
+ * @return 0 on success, -1 if no segment lies within max_dist
+ */
+int snap_to_edge(const EdgeGrid *eg, const Graph *g, double lat, double lon,
+                 double max_dist, EdgeSnap *out);
+
+// Project a coordinate into the grid's plane (meters)
+static inline void spatial_project(const SpatialGrid *grid, double lat, double lon, double *x, double *y)
+{
+    *x = (lon - grid->lon0) * grid->m_per_deg_lon;
+    *y = (lat - grid->lat0) * grid->m_per_deg_lat;
+}
+
+#endif // SPATIAL_H
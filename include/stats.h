@@ -0,0 +1,97 @@
+#ifndef STATS_H
+#define STATS_H
+
+// ========================
+// Request instrumentation
+// Hot-path counters (nodes settled, edges relaxed, heap pushes / pops,
+// result allocation bytes) and monotonic per-phase timing. Compiled in with
+// -DENABLE_STATS (make STATS=1); otherwise every macro below is empty and
+// costs nothing.
+//
+// Counters live in a per-thread block and are plain increments. Work done on
+// helper threads of an OpenMP loop is credited to the thread that started
+// the loop (STATS_CREDIT_*), so a request's numbers are the difference of its
+// own thread's block between two marks.
+// ========================
+
+#ifdef ENABLE_STATS
+#define STATS_ENABLED 1
+#else
+#define STATS_ENABLED 0
+#endif
+
+typedef enum {
+    STAT_NODES_SETTLED,
+    STAT_EDGES_RELAXED,
+    STAT_HEAP_PUSHES,
+    STAT_HEAP_POPS,
+    STAT_ALLOC_BYTES,
+    STAT_NUM_COUNTERS
+} StatCounter;
+
+typedef enum {
+    PHASE_SEARCH,
+    PHASE_INSTRUCTIONS,
+    PHASE_SERIALIZE,
+    STAT_NUM_PHASES
+} StatPhase;
+
+// Counters and phase times of one request (or a sum of requests)
+typedef struct {
+    unsigned long long counters[STAT_NUM_COUNTERS];
+    double seconds[STAT_NUM_PHASES];
+} QueryStats;
+
+typedef struct {
+    unsigned long long own[STAT_NUM_COUNTERS];    // this thread's work
+    unsigned long long shared[STAT_NUM_COUNTERS]; // credited by helper threads (atomic adds)
+    double seconds[STAT_NUM_PHASES];
+} StatsBlock;
+
+extern StatsBlock thread_stats;
+#pragma omp threadprivate(thread_stats)
+
+// Helper thread work since start, to be added to caller when the iteration ends
+typedef struct {
+    StatsBlock* caller;
+    unsigned long long start[STAT_NUM_COUNTERS];
+} StatsCredit;
+
+// Monotonic clock in seconds
+double stats_now(void);
+
+// Calling thread's totals so far (own + credited)
+void stats_mark(QueryStats* mark);
+
+// out = calling thread's totals now - mark
+void stats_since(const QueryStats* mark, QueryStats* out);
+
+void stats_credit_begin(StatsCredit* credit, StatsBlock* caller);
+void stats_credit_end(StatsCredit* credit);
+
+// Process-wide totals of finished requests (the daemon adds every request)
+void stats_aggregate(const QueryStats* request);
+void stats_totals(QueryStats* out, unsigned long long* requests);
+
+// Seconds load_campus_resources() took in this process
+void stats_set_load_time(double seconds);
+double stats_load_time(void);
+
+#if STATS_ENABLED
+#define STAT_ADD(counter, n) (thread_stats.own[counter] += (unsigned long long)(n))
+#define STATS_PHASE_BEGIN(var) double var = stats_now()
+#define STATS_PHASE_END(phase, var) (thread_stats.seconds[phase] += stats_now() - (var))
+// In the body of an OpenMP loop: credit this iteration's work to the caller's block
+#define STATS_CALLER(var) StatsBlock* var = &thread_stats
+#define STATS_CREDIT_BEGIN(var, caller) StatsCredit var; stats_credit_begin(&var, caller)
+#define STATS_CREDIT_END(var) stats_credit_end(&var)
+#else
+#define STAT_ADD(counter, n) ((void)0)
+#define STATS_PHASE_BEGIN(var) ((void)0)
+#define STATS_PHASE_END(phase, var) ((void)0)
+#define STATS_CALLER(var) ((void)0)
+#define STATS_CREDIT_BEGIN(var, caller) ((void)0)
+#define STATS_CREDIT_END(var) ((void)0)
+#endif
+
+#endif // STATS_H
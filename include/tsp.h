@@ -2,18 +2,64 @@
 #define TSP_H
 
 #include "graph.h"
+#include "astar.h"
+
+// Held-Karp needs 2^M * M table entries for M buildings with a free
+// position (fixed start / end are not DP states): exact solving stops here
+#define TSP_EXACT_MAX_BUILDINGS 20
+// Largest M that --tsp-solver=auto still solves exactly
+#define TSP_AUTO_EXACT_MAX 16
+
+typedef enum {
+    TSP_SOLVER_AUTO = 0, // exact up to TSP_AUTO_EXACT_MAX buildings, heuristic above
+    TSP_SOLVER_EXACT,
+    TSP_SOLVER_HEURISTIC
+} TspSolver;
+
+// Which buildings keep their place (start = names[0], end = names[N-1])
+typedef enum {
+    TSP_MODE_OPEN = 0,    // free start and end
+    TSP_MODE_FIXED_START, // fixed start, free end
+    TSP_MODE_FIXED_ENDS,  // fixed start and end
+    TSP_MODE_ROUND_TRIP   // closed tour from the start back to it
+} TspMode;
+
+typedef struct {
+    TspSolver solver;
+    TspMode mode;
+    double time_budget; // seconds for the heuristic solver
+} TspOptions;
+
+/**
+ * Shortest path through all N points of a distance matrix (Held-Karp)
+ *
+ * @param dist   Row-major N x N distances, DBL_MAX = unreachable
+ * @param N      Number of points, at most TSP_EXACT_MAX_BUILDINGS free ones
+ * @param first  Point that must come first, -1 if free
+ * @param last   Point that must come last, -1 if free; last == first (>= 0) is a
+ *               round trip whose length includes the leg back to first
+ * @param order  (Output) N point indices in visiting order
+ * @return length of the path, >= 1e18 if it needs an unreachable leg
+ */
+double tsp_held_karp(const double* dist, int N, int first, int last, int* order);
 
 /**
  * Find optimal route to visit multiple buildings using Held-Karp algorithm
- * Uses Dijkstra for efficient pairwise distance computation (parallelized with OpenMP)
+ * (or the heuristic solver in tsp_heuristic.h, see TspOptions)
+ * Pairwise distances come from distance_matrix() (parallelized with OpenMP);
+ * only the legs of the optimal order are searched for their node paths
  * 
  * @param graph         Pointer to campus graph
  * @param mapping       Building name to node ID mapping
  * @param names         Array of building names to visit
  * @param N             Number of buildings to visit
+ * @param search        Point-to-point search used for the legs (NULL = astar)
+ * @param tsp           Solver, mode and time budget (NULL = auto, open, default budget)
  * @param out_dist      (Output) Total distance of optimal route
  * @param out_path      (Output) Complete path with all intermediate nodes
  * @param out_len       (Output) Length of the complete path
+ * @param out_order     (Output, may be NULL) N indices into names in visiting
+ *                      order; a round trip returns to out_order[0] at the end
  * @return 0 on success, -1 on error
  */
 int find_optimal_multi_building_route(
@@ -21,9 +67,12 @@ int find_optimal_multi_building_route(
     BuildingMapping* mapping,
     const char** names,
     int N,
+    PathSearchFn search,
+    const TspOptions* tsp,
     double* out_dist,
     int** out_path,
-    int* out_len
+    int* out_len,
+    int* out_order
 );
 
 #endif // TSP_H
\ No newline at end of file
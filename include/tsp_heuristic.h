@@ -0,0 +1,30 @@
+#ifndef TSP_HEURISTIC_H
+#define TSP_HEURISTIC_H
+
+// ========================
+// Heuristic visiting order for instances beyond Held-Karp
+// Nearest-neighbor construction, then 2-opt and Or-opt moves restricted to
+// each building's nearest neighbors, then iterated local search with
+// double-bridge kicks. Every OpenMP thread runs its own restarts until the
+// time budget is spent or it stops improving; the best order wins.
+// Distances may be asymmetric (one-way streets): 2-opt prices the reversed
+// segment, Or-opt never reverses.
+// ========================
+
+#define TSP_HEURISTIC_DEFAULT_BUDGET 0.2 // seconds
+
+/**
+ * Short open path through all N points of a distance matrix
+ *
+ * @param dist         Row-major N x N distances, DBL_MAX = unreachable
+ * @param N            Number of points
+ * @param first        Point that must come first, -1 if free
+ * @param last         Point that must come last, -1 if free
+ * @param time_budget  Wall-clock limit in seconds
+ * @param order        (Output) N point indices in visiting order
+ * @return length of the path, DBL_MAX if it needs an unreachable leg
+ */
+double tsp_heuristic(const double* dist, int N, int first, int last,
+                     double time_budget, int* order);
+
+#endif // TSP_HEURISTIC_H
@@ -4,9 +4,22 @@
 #include <stdio.h>
 #include "graph.h"
 #include "tsp.h"
+#include "cache.h"
+#include "stats.h"
 
 #define R 6371000.0 // raduis of the Earth in meters
 
+// Encoding of the route geometry in responses (--format=...)
+typedef enum {
+    PATH_FORMAT_COORDINATES, // "path_coordinates": [[lat, lon], ...] (default)
+    PATH_FORMAT_POLYLINE5,   // "path": Google encoded polyline, 1e-5 degrees
+    PATH_FORMAT_POLYLINE6,   // "path": encoded polyline, 1e-6 degrees
+    PATH_FORMAT_DELTA32      // "path": base64 little-endian int32, first point then deltas, 1e-6 degrees
+} PathFormat;
+
+// Name (json|polyline5|polyline6|delta32) -> format, returns -1 if unknown
+int path_format_from_name(const char* name, PathFormat* out);
+
 // Struct to hold standard response data to avoid passing many arguments
 typedef struct {
     double total_distance;
@@ -18,17 +31,37 @@ typedef struct {
     int instruction_count;
     int status_code;    // 0 = success, 1 = error
     char* error_message;
+    int has_start;         // coordinate query: start_point is drawn before path_node_ids[0]
+    int has_end;           // coordinate query: end_point is drawn after the last node
+    double start_point[2]; // snapped start (lat, lon)
+    double end_point[2];   // snapped destination (lat, lon)
+    const QueryStats* stats_mark; // --stats=on: counters since this mark are added as "stats"
 } NavigationResult;
 
 // Helper to init result with defaults
 void init_result(NavigationResult* res);
 void free_result(NavigationResult* res);
 
-// Outputs the NavigationResult structure as formatted JSON to STDOUT
-void print_json_response(NavigationResult* res, Graph* campus);
+// Outputs the NavigationResult structure as formatted JSON to the given stream,
+// with the path geometry in the requested format
+void print_json_response(FILE* out, NavigationResult* res, Graph* campus, PathFormat format);
+
+// Outputs an n x n distance matrix (row-major, DBL_MAX = unreachable -> null) as JSON
+void print_json_matrix(FILE* out, const char** names, int n, const double* dist);
+
+// Outputs the names of the given building entries as {"status", "buildings": [...]}
+void print_json_buildings(FILE* out, const BuildingMapping* mapping, const int* entries, int n);
+
+// Outputs the counters of the response and leg caches (NULL = disabled -> null)
+void print_json_cache_stats(FILE* out, const LruStats* responses, const LruStats* legs);
+
+// Outputs the counters summed over every request this process served, with
+// per-request phase means (--stats-summary)
+void print_json_stats_summary(FILE* out, const QueryStats* totals, unsigned long long requests,
+                              double load_seconds);
 
-// Helper to print errors to stderr and return a JSON error to stdout
-void print_json_error(const char* message);
+// Helper to write a JSON error object to the given stream
+void print_json_error(FILE* out, const char* message);
 
 double haversine(double lat1, double lon1, double lat2, double lon2);
 
@@ -1,8 +1,46 @@
 #ifndef VIA_POINT_H
 #define VIA_POINT_H
 #include "graph.h"
+#include "astar.h"
+#include "spatial.h"
 
+// search: algorithm used for every segment (NULL = astar)
 double astar_via_points(Graph* graph, int start_id, int goal_id,int* via_ids,
-    int num_via,int** out_path,int* out_len);
+    int num_via,int** out_path,int* out_len, PathSearchFn search);
   // via n point   n can be 0,1,2 or others
+
+/**
+ * Reorder via points for a short start -> vias -> goal route (start and goal stay fixed)
+ * Distances come from distance_matrix() with start and every via point as sources,
+ * i.e. one multi-target search per via point; the order is built by cheapest
+ * insertion and polished with 2-opt, which is plenty for the handful of stops
+ * a navigate query carries (use --tsp for exact orders)
+ *
+ * @param graph     Pointer to graph
+ * @param start_id  Start node ID
+ * @param goal_id   Goal node ID
+ * @param via_ids   (In/Out) via node IDs, reordered in place
+ * @param num_via   Number of via points
+ */
+void order_via_points(Graph* graph, int start_id, int goal_id, int* via_ids, int num_via);
+
+/**
+ * Shortest route between two snapped coordinates (see snap_to_edge)
+ * Each snapped point acts as a virtual node on its segment: the source leaves
+ * towards the segment ends it may drive to, the target is entered from the
+ * ends that lead to it, at the matching fraction of the edge weight. The
+ * graph is not modified: a distance_matrix() over those (at most 2 x 2) end
+ * nodes picks the best pair, then search() finds its path.
+ *
+ * @param graph     Pointer to graph
+ * @param from      Snapped start
+ * @param to        Snapped destination
+ * @param search    Point-to-point search for the graph part (NULL = astar)
+ * @param out_path  (Output) graph nodes between the two points, NULL if the
+ *                  route stays on one segment
+ * @param out_len   (Output) number of nodes in out_path
+ * @return route length including both partial edges, DBL_MAX if unreachable
+ */
+double route_between_snaps(Graph* graph, const EdgeSnap* from, const EdgeSnap* to,
+                           PathSearchFn search, int** out_path, int* out_len);
 #endif
\ No newline at end of file
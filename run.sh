@@ -22,6 +22,8 @@ echo "===== Building C Backend ====="
 make clean
 make || { echo "ERROR: Build failed"; exit 1; }
 echo "✓ Build successful"
+make snapshot || echo "WARNING: Snapshot not built, falling back to CSV loading"
+make ch || echo "WARNING: Contraction hierarchy not built, --algo=ch falls back to bidirectional A*"
 
 # ===== Check Python Environment =====
 echo ""
@@ -41,10 +43,20 @@ if ! $PYTHON_CMD -c "import flask" 2>/dev/null; then
 fi
 echo "✓ Flask is available"
 
+# ===== Start Routing Daemon =====
+echo ""
+echo "===== Starting Routing Daemon ====="
+cd "${PROJECT_PATH}/src" || { echo "ERROR: Failed to cd to src"; exit 1; }
+
+export BUZZNAV_SOCKET="/tmp/buzznav_$$.sock"
+"${PROJECT_PATH}/bin/main" --serve "$BUZZNAV_SOCKET" &
+DAEMON_PID=$!
+trap 'kill $DAEMON_PID 2>/dev/null' EXIT
+echo "✓ Daemon started (pid $DAEMON_PID, socket $BUZZNAV_SOCKET)"
+
 # ===== Start Flask Server =====
 echo ""
 echo "===== Starting Flask Server ====="
-cd "${PROJECT_PATH}/src" || { echo "ERROR: Failed to cd to src"; exit 1; }
 
 echo ""
 echo "=========================================="
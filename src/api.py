@@ -1,11 +1,14 @@
 import subprocess
 import json
 import os
-import csv
+import socket
 from flask import Flask, request, jsonify, send_from_directory
 
 app = Flask(__name__, static_folder=os.path.join(os.path.dirname(__file__), '..', 'frontend'), static_url_path='')
 EXECUTABLE_PATH = os.path.join(os.path.dirname(__file__), '..', 'bin', 'main')
+DAEMON_SOCKET = os.environ.get('BUZZNAV_SOCKET', '/tmp/buzznav.sock')
+# The daemon reads one query per line with tab-separated arguments
+FRAMING_CHARS = ('\t', '\r', '\n')
 
 # ==========================================
 # 1. Centralized Response Handler
@@ -42,22 +45,13 @@ class ResponseHandler:
         if not stdout_str or not stdout_str.strip():
             return None, False, "C program returned empty output."
 
+        # stdout carries exactly one JSON document, logs go to stderr
         try:
-            # 1. Attempt Clean Parse
             data = json.loads(stdout_str)
         except json.JSONDecodeError:
-            # 2. Attempt "Fuzzy" Parse (extract JSON from mixed logs)
-            try:
-                start = stdout_str.find('{')
-                end = stdout_str.rfind('}')
-                if start != -1 and end != -1:
-                    data = json.loads(stdout_str[start:end+1])
-                else:
-                    return None, False, "No JSON object found in output."
-            except Exception:
-                return None, False, f"Failed to parse JSON: {stdout_str[:100]}..."
-
-        # 3. Check Logic Error from C (e.g. {"status": "error", ...})
+            return None, False, f"Failed to parse JSON: {stdout_str[:100]}..."
+
+        # Check Logic Error from C (e.g. {"status": "error", ...})
         if data.get("status") == "error":
             msg = data.get("message", "Unknown error from C backend")
             return None, False, msg
@@ -67,10 +61,44 @@ class ResponseHandler:
 # ==========================================
 # 2. C Execution Helper
 # ==========================================
-def execute_backend(args):
+def query_daemon(args):
+    """
+    Sends one query to the BuzzNav daemon (bin/main --serve).
+    Returns the raw JSON string, or None if the daemon is not running.
+    """
+    if not os.path.exists(DAEMON_SOCKET):
+        return None
+    try:
+        with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+            sock.connect(DAEMON_SOCKET)
+            stream = sock.makefile('rwb')
+            stream.write(('\t'.join(args) + '\n').encode('utf-8'))
+            stream.flush()
+            header = stream.readline()
+            if not header:
+                return None
+            return stream.read(int(header)).decode('utf-8')
+    except (OSError, ValueError):
+        return None
+
+def execute_backend(args, transform=None):
     """
     Helper to run the C executable and return a Flask Response immediately.
+    Prefers the persistent daemon and falls back to one process per request.
+    transform (optional) maps the parsed payload before it is returned.
     """
+    # A tab or line break inside an argument would split or end the daemon's query line;
+    # refused on both paths so a query means the same with or without the daemon
+    if any(c in arg for arg in args for c in FRAMING_CHARS):
+        return ResponseHandler.error("Parameters must not contain tabs or line breaks", status_code=400)
+
+    daemon_output = query_daemon(args)
+    if daemon_output is not None:
+        data, is_success, err_msg = ResponseHandler.parse_c_output(daemon_output, "")
+        if is_success:
+            return ResponseHandler.success(transform(data) if transform else data)
+        return ResponseHandler.error(err_msg, status_code=400)
+
     if not os.path.exists(EXECUTABLE_PATH):
         return ResponseHandler.error(
             f"Executable not found", 
@@ -94,7 +122,7 @@ def execute_backend(args):
         data, is_success, err_msg = ResponseHandler.parse_c_output(process.stdout, process.stderr)
 
         if is_success:
-            return ResponseHandler.success(data)
+            return ResponseHandler.success(transform(data) if transform else data)
         else:
             # If it's a logic error (e.g. building not found), usually 400 is better than 500
             # You can decide to return 400 or 500 based on the message content if you want.
@@ -110,21 +138,15 @@ def execute_backend(args):
 
 @app.route("/api/buildings")
 def get_buildings():
-    try:
-        buildings = []
-        csv_path = os.path.join(os.path.dirname(__file__), '..', 'data', 'building_mapping.csv')
-        
-        if not os.path.exists(csv_path):
-            return ResponseHandler.error("Database file (CSV) not found", status_code=404)
-
-        with open(csv_path, mode='r', encoding='utf-8') as f:
-            reader = csv.DictReader(f)
-            for row in reader:
-                buildings.append(row['building_name'])
-        
-        return ResponseHandler.success(buildings)
-    except Exception as e:
-        return ResponseHandler.error(str(e), status_code=500)
+    # Served from the backend's building index (?prefix=Stu&limit=10 for autocomplete)
+    cmd_args = ["--buildings"]
+    prefix = request.args.get('prefix', '').strip()
+    if prefix:
+        cmd_args.append(prefix)
+    limit = request.args.get('limit')
+    if limit:
+        cmd_args.append(f'--limit={limit}')
+    return execute_backend(cmd_args, transform=lambda data: data.get("buildings", []))
 
 @app.route("/api/navigate")
 def get_navigation():
@@ -142,6 +164,35 @@ def get_navigation():
     
     # 4. Execute
     cmd_args = [start] + clean_via + [end]
+    algo = request.args.get('algo')
+    if algo:
+        cmd_args.append(f'--algo={algo}')
+    via_order = request.args.get('via_order')
+    if via_order:
+        cmd_args.append(f'--via-order={via_order}')
+    fmt = request.args.get('format')
+    if fmt:
+        cmd_args.append(f'--format={fmt}')
+    return execute_backend(cmd_args)
+
+@app.route("/api/navigate-coord")
+def get_navigation_coord():
+    # 1. Extract (?from=lat,lon&to=lat,lon)
+    origin = request.args.get('from', '').strip()
+    destination = request.args.get('to', '').strip()
+
+    # 2. Validate
+    if not origin or not destination:
+        return ResponseHandler.error("Missing required parameters: 'from' and 'to'", status_code=400)
+
+    # 3. Execute
+    cmd_args = ["--from-coord", origin, "--to-coord", destination]
+    algo = request.args.get('algo')
+    if algo:
+        cmd_args.append(f'--algo={algo}')
+    fmt = request.args.get('format')
+    if fmt:
+        cmd_args.append(f'--format={fmt}')
     return execute_backend(cmd_args)
 
 @app.route("/api/navigate-tsp")
@@ -161,8 +212,32 @@ def get_navigation_tsp():
     
     # 3. Execute
     cmd_args = ["--tsp"] + buildings
+    solver = request.args.get('solver')
+    if solver:
+        cmd_args.append(f'--tsp-solver={solver}')
+    budget = request.args.get('budget_ms')
+    if budget:
+        cmd_args.append(f'--tsp-budget={budget}')
+    mode = request.args.get('mode')
+    if mode:
+        cmd_args.append(f'--tsp-mode={mode}')
+    fmt = request.args.get('format')
+    if fmt:
+        cmd_args.append(f'--format={fmt}')
     return execute_backend(cmd_args)
 
+@app.route("/api/matrix")
+def get_distance_matrix():
+    # 1. Extract (?building=A&building=B...)
+    buildings = [b.strip() for b in request.args.getlist('building') if b.strip()]
+
+    # 2. Validate
+    if not buildings:
+        return ResponseHandler.error("Missing required parameter: 'building'", status_code=400)
+
+    # 3. Execute
+    return execute_backend(["--matrix"] + buildings)
+
 
 # ==========================================
 # 4. Static Files
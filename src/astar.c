@@ -2,101 +2,20 @@
 #include <stdlib.h>
 #include <float.h>
 #include <math.h>
+#include <string.h>
 #include "graph.h"
 #include "utils.h"
 #include "astar.h"
-
-/**
- * A* Node in the priority queue
- */
-typedef struct {
-    int node_id;
-    double f_score;
-} PQNode;
-
-/**
- * Simple min-heap priority queue
- */
-typedef struct {
-    PQNode* data;
-    int size;
-    int capacity;
-} PriorityQueue;
-
-static PriorityQueue* create_pq(int capacity) {
-    PriorityQueue* pq = malloc(sizeof(PriorityQueue));
-    pq->data = malloc(sizeof(PQNode) * capacity);
-    pq->size = 0;
-    pq->capacity = capacity;
-    return pq;
-}
-
-static void free_pq(PriorityQueue* pq) {
-    if (!pq) return;
-    free(pq->data);
-    free(pq);
-}
-
-static void pq_swap(PQNode* a, PQNode* b) {
-    PQNode tmp = *a; *a = *b; *b = tmp;
-}
-
-static void pq_push(PriorityQueue* pq, int node_id, double f_score) {
-    if (pq->size >= pq->capacity) return;
-    pq->data[pq->size].node_id = node_id;
-    pq->data[pq->size].f_score = f_score;
-    int i = pq->size++;
-    while (i > 0) {
-        int parent = (i - 1) / 2;
-        if (pq->data[parent].f_score <= pq->data[i].f_score) break;
-        pq_swap(&pq->data[parent], &pq->data[i]);
-        i = parent;
-    }
-}
-
-static int pq_pop(PriorityQueue* pq) {
-    if (pq->size == 0) return -1;
-    int node_id = pq->data[0].node_id;
-    pq->data[0] = pq->data[--pq->size];
-    int i = 0;
-    while (1) {
-        int l = 2*i + 1, r = 2*i + 2, smallest = i;
-        if (l < pq->size && pq->data[l].f_score < pq->data[smallest].f_score) smallest = l;
-        if (r < pq->size && pq->data[r].f_score < pq->data[smallest].f_score) smallest = r;
-        if (smallest == i) break;
-        pq_swap(&pq->data[i], &pq->data[smallest]);
-        i = smallest;
-    }
-    return node_id;
-}
-
-static int pq_empty(PriorityQueue* pq) {
-    return pq->size == 0;
-}
-
-/**
- * Reconstruct path by backtracking
- */
-static int* reconstruct_path(int* came_from, int start, int goal, int* out_length) {
-    int* path = malloc(sizeof(int) * 1000);
-    int count = 0;
-    for (int curr = goal; curr != -1; curr = came_from[curr])
-        path[count++] = curr;
-
-    // reverse path
-    for (int i = 0; i < count / 2; i++) {
-        int tmp = path[i];
-        path[i] = path[count - i - 1];
-        path[count - i - 1] = tmp;
-    }
-
-    *out_length = count;
-    return path;
-}
+#include "ch.h"
+#include "landmarks.h"
+#include "search_context.h"
 
 /**
  * Core A* Algorithm
  * 
+ * Labels, closed set and heap live in the calling thread's SearchContext,
+ * so the only allocation per query is the returned path.
+ *
  * @param graph      Pointer to graph
  * @param start_id   Start node ID
  * @param goal_id    Goal node ID
@@ -105,57 +24,154 @@ static int* reconstruct_path(int* came_from, int start, int goal, int* out_lengt
  * @return total distance of shortest path (or DBL_MAX if no path)
  */
 double astar(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len) {
-    int n = graph->num_nodes;
-    double* g_score = malloc(sizeof(double) * n);
-    double* f_score = malloc(sizeof(double) * n);
-    int* came_from = malloc(sizeof(int) * n);
-    int* visited = calloc(n, sizeof(int));
-
-    for (int i = 0; i < n; i++) {
-        g_score[i] = DBL_MAX;
-        f_score[i] = DBL_MAX;
-        came_from[i] = -1;
-    }
+    SearchContext* ctx = search_context_acquire(graph);
+    search_context_begin(ctx);
+    PQueue* open_set = &ctx->side[0].heap;
 
-    g_score[start_id] = 0.0;
-    f_score[start_id] = haversine(
-        graph->nodes[start_id].lat, graph->nodes[start_id].lon,
-        graph->nodes[goal_id].lat, graph->nodes[goal_id].lon
-    );
+    double goal_lat = graph->lat[goal_id], goal_lon = graph->lon[goal_id];
 
-    PriorityQueue* open_set = create_pq(n);
-    pq_push(open_set, start_id, f_score[start_id]);
+    sc_set(ctx, 0, start_id, 0.0, -1, -1);
+    pq_push(open_set, start_id, haversine(graph->lat[start_id], graph->lon[start_id], goal_lat, goal_lon));
 
     while (!pq_empty(open_set)) {
-        int current = pq_pop(open_set);
+        int current = pq_pop(open_set, NULL);
         if (current == goal_id) {
-            *out_path = reconstruct_path(came_from, start_id, goal_id, out_len);
-            double total_dist = g_score[goal_id];
-            free(g_score); free(f_score); free(came_from); free(visited); free_pq(open_set);
-            return total_dist;
+            *out_path = sc_build_path(ctx, 0, goal_id, out_len);
+            return sc_dist(ctx, 0, goal_id);
         }
 
-        if (visited[current]) continue;
-        visited[current] = 1;
-
-        for (Edge* e = graph->nodes[current].neighbors; e; e = e->next) {
-            int neighbor = e->to;
-            double tentative_g = g_score[current] + e->weight;
-            if (tentative_g < g_score[neighbor]) {
-                came_from[neighbor] = current;
-                g_score[neighbor] = tentative_g;
-                f_score[neighbor] = tentative_g + haversine(
-                    graph->nodes[neighbor].lat, graph->nodes[neighbor].lon,
-                    graph->nodes[goal_id].lat, graph->nodes[goal_id].lon
+        if (sc_closed(ctx, 0, current)) continue;
+        sc_close(ctx, 0, current);
+
+        double current_g = sc_dist(ctx, 0, current);
+        STAT_ADD(STAT_EDGES_RELAXED, graph->offsets[current + 1] - graph->offsets[current]);
+        for (int e = graph->offsets[current]; e < graph->offsets[current + 1]; e++) {
+            int neighbor = graph->targets[e];
+            double tentative_g = current_g + graph->weights[e];
+            if (tentative_g < sc_dist(ctx, 0, neighbor)) {
+                sc_set(ctx, 0, neighbor, tentative_g, current, e);
+                double f_score = tentative_g + haversine(
+                    graph->lat[neighbor], graph->lon[neighbor],
+                    goal_lat, goal_lon
                 );
-                pq_push(open_set, neighbor, f_score[neighbor]);
+                pq_push(open_set, neighbor, f_score);
             }
         }
     }
 
     // If no path found
-    free(g_score); free(f_score); free(came_from); free(visited); free_pq(open_set);
     *out_path = NULL;
     *out_len = 0;
     return DBL_MAX;
 }
+
+/**
+ * Bidirectional A*
+ *
+ * Forward search from start over out-edges, backward search from goal over
+ * in-edges (reverse CSR). Both use the average potential
+ *     p(v) = (h(v, goal) - h(start, v)) / 2
+ * forward key = g_f(v) + p(v), backward key = g_b(v) - p(v), which keeps the
+ * reduced edge costs identical in both directions. The best meeting distance
+ * mu is final once min forward key + min backward key >= mu.
+ *
+ * Same parameters and return value as astar()
+ */
+double astar_bidirectional(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len) {
+    if (start_id == goal_id) {
+        *out_path = malloc(sizeof(int));
+        (*out_path)[0] = start_id;
+        *out_len = 1;
+        return 0.0;
+    }
+
+    // side 0: parent = predecessor towards start, side 1: parent = successor towards goal
+    // ctx->value caches the potential p(v)
+    SearchContext* ctx = search_context_acquire(graph);
+    search_context_begin(ctx);
+
+    double start_lat = graph->lat[start_id], start_lon = graph->lon[start_id];
+    double goal_lat = graph->lat[goal_id], goal_lon = graph->lon[goal_id];
+    double half_span = 0.5 * haversine(start_lat, start_lon, goal_lat, goal_lon);
+    sc_set_value(ctx, start_id, half_span);
+    sc_set_value(ctx, goal_id, -half_span);
+
+    sc_set(ctx, 0, start_id, 0.0, -1, -1);
+    sc_set(ctx, 1, goal_id, 0.0, -1, -1);
+    pq_push(&ctx->side[0].heap, start_id, half_span);
+    pq_push(&ctx->side[1].heap, goal_id, half_span);
+
+    double best = DBL_MAX; // mu: shortest start->goal distance seen so far
+    int meeting = -1;
+
+    while (!pq_empty(&ctx->side[0].heap) && !pq_empty(&ctx->side[1].heap)) {
+        double key0 = pq_min_key(&ctx->side[0].heap);
+        double key1 = pq_min_key(&ctx->side[1].heap);
+        if (key0 + key1 >= best) break;
+
+        // expand the side with the smaller frontier key
+        int side = key0 <= key1 ? 0 : 1;
+        int other = 1 - side;
+        double sign = side == 0 ? 1.0 : -1.0;
+
+        int current = pq_pop(&ctx->side[side].heap, NULL);
+        if (sc_closed(ctx, side, current)) continue;
+        sc_close(ctx, side, current);
+
+        const int* offsets = side == 0 ? graph->offsets : graph->rev_offsets;
+        const int* adjacent = side == 0 ? graph->targets : graph->rev_sources;
+        const double* weights = side == 0 ? graph->weights : graph->rev_weights;
+
+        double current_g = sc_dist(ctx, side, current);
+        STAT_ADD(STAT_EDGES_RELAXED, offsets[current + 1] - offsets[current]);
+        for (int e = offsets[current]; e < offsets[current + 1]; e++) {
+            int neighbor = adjacent[e];
+            double tentative_g = current_g + weights[e];
+            if (tentative_g >= sc_dist(ctx, side, neighbor)) continue;
+
+            sc_set(ctx, side, neighbor, tentative_g, current, e);
+
+            if (!sc_has_value(ctx, neighbor)) {
+                double to_goal = haversine(graph->lat[neighbor], graph->lon[neighbor], goal_lat, goal_lon);
+                double from_start = haversine(start_lat, start_lon, graph->lat[neighbor], graph->lon[neighbor]);
+                sc_set_value(ctx, neighbor, 0.5 * (to_goal - from_start));
+            }
+            pq_push(&ctx->side[side].heap, neighbor, tentative_g + sign * ctx->value[neighbor]);
+
+            double other_g = sc_dist(ctx, other, neighbor);
+            if (other_g != DBL_MAX && tentative_g + other_g < best) {
+                best = tentative_g + other_g;
+                meeting = neighbor;
+            }
+        }
+    }
+
+    if (meeting == -1) {
+        *out_path = NULL;
+        *out_len = 0;
+        return DBL_MAX;
+    }
+
+    // start .. meeting from the forward tree, then meeting .. goal from the backward tree
+    int forward_len = 0, backward_len = 0;
+    for (int v = meeting; v != -1; v = sc_parent(ctx, 0, v)) forward_len++;
+    for (int v = sc_parent(ctx, 1, meeting); v != -1; v = sc_parent(ctx, 1, v)) backward_len++;
+
+    int* path = malloc(sizeof(int) * (forward_len + backward_len));
+    int idx = forward_len - 1;
+    for (int v = meeting; v != -1; v = sc_parent(ctx, 0, v)) path[idx--] = v;
+    idx = forward_len;
+    for (int v = sc_parent(ctx, 1, meeting); v != -1; v = sc_parent(ctx, 1, v)) path[idx++] = v;
+
+    *out_path = path;
+    *out_len = forward_len + backward_len;
+    return best;
+}
+
+PathSearchFn find_search_algorithm(const char* name) {
+    if (strcmp(name, "astar") == 0) return astar;
+    if (strcmp(name, "bidir") == 0) return astar_bidirectional;
+    if (strcmp(name, "ch") == 0) return ch_query;
+    if (strcmp(name, "alt") == 0) return astar_alt;
+    return NULL;
+}
@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <omp.h>
+#include "graph.h"
+#include "handlers.h"
+#include "logging.h"
+#include "batch.h"
+
+/*
+* workers share one reader: a query line is claimed under the lock, answered
+* without it (search workspaces and JSON buffers are per thread), and its
+* result goes back under the lock
+* input order: results wait in a ring of BATCH_WINDOW_PER_WORKER * workers
+* slots until every earlier line has been written
+*/
+
+#define BATCH_WINDOW_PER_WORKER 64
+
+typedef struct {
+    char* data; // JSON line, NULL for a skipped blank line
+    size_t len;
+    int ready;
+} BatchSlot;
+
+typedef struct {
+    FILE* in;
+    FILE* out;
+    BatchOrder order;
+    pthread_mutex_t lock;
+    pthread_cond_t space;   // the oldest unwritten line moved on
+    long next_id;           // line number of the next line to read
+    long next_out;          // oldest line not written yet (input order)
+    int at_end;
+    int write_failed;
+    long answered;
+    BatchSlot* slots;
+    long window;
+} BatchState;
+
+int batch_order_from_name(const char* name, BatchOrder* out) {
+    if (strcmp(name, "input") == 0) *out = BATCH_ORDER_INPUT;
+    else if (strcmp(name, "any") == 0) *out = BATCH_ORDER_ANY;
+    else return -1;
+    return 0;
+}
+
+// {"id": <id>, "response": <body with its layout newlines and indentation removed>}
+// Strings in a response are escaped, so every raw newline is layout.
+static char* batch_line(long id, const char* body, size_t body_len, size_t* out_len) {
+    char* line = malloc(body_len + 48);
+    size_t n = (size_t)sprintf(line, "{\"id\": %ld, \"response\": ", id);
+    for (size_t i = 0; i < body_len; i++) {
+        if (body[i] == '\n') {
+            while (i + 1 < body_len && body[i + 1] == ' ') i++;
+            continue;
+        }
+        line[n++] = body[i];
+    }
+    line[n++] = '}';
+    line[n++] = '\n';
+    *out_len = n;
+    return line;
+}
+
+// Caller holds the lock
+static void write_result(BatchState* state, char* data, size_t len) {
+    if (data && !state->write_failed && fwrite(data, 1, len, state->out) != len) {
+        state->write_failed = 1;
+    }
+    free(data);
+}
+
+// Caller holds the lock: store line id, then write every line that is now in order
+static void finish_line(BatchState* state, long id, char* data, size_t len) {
+    if (state->order == BATCH_ORDER_ANY) {
+        write_result(state, data, len);
+        return;
+    }
+
+    BatchSlot* slot = &state->slots[id % state->window];
+    slot->data = data;
+    slot->len = len;
+    slot->ready = 1;
+
+    int moved = 0;
+    while (state->slots[state->next_out % state->window].ready) {
+        slot = &state->slots[state->next_out % state->window];
+        write_result(state, slot->data, slot->len);
+        slot->data = NULL;
+        slot->ready = 0;
+        state->next_out++;
+        moved = 1;
+    }
+    if (moved) pthread_cond_broadcast(&state->space);
+}
+
+static void batch_worker(BatchState* state, Graph* campus, BuildingMapping* mapping) {
+    char* line = NULL;
+    size_t line_cap = 0;
+    char* argv[MAX_QUERY_ARGS];
+
+    for (;;) {
+        pthread_mutex_lock(&state->lock);
+        while (!state->at_end && state->order == BATCH_ORDER_INPUT &&
+               state->next_id - state->next_out >= state->window) {
+            pthread_cond_wait(&state->space, &state->lock);
+        }
+        if (state->at_end || getline(&line, &line_cap, state->in) <= 0) {
+            state->at_end = 1;
+            pthread_cond_broadcast(&state->space);
+            pthread_mutex_unlock(&state->lock);
+            break;
+        }
+        long id = state->next_id++;
+        pthread_mutex_unlock(&state->lock);
+
+        char* result = NULL;
+        size_t result_len = 0;
+        if (line[strspn(line, " \t\r\n")] != '\0') {
+            int argc = split_query_line(line, argv, MAX_QUERY_ARGS);
+            char* body = NULL;
+            size_t body_len = 0;
+            FILE* stream = open_memstream(&body, &body_len);
+            if (stream) {
+                dispatch_request(stream, campus, mapping, argc, argv);
+                fclose(stream);
+                result = batch_line(id, body, body_len, &result_len);
+                free(body);
+            }
+        }
+
+        pthread_mutex_lock(&state->lock);
+        if (result) state->answered++;
+        finish_line(state, id, result, result_len);
+        pthread_mutex_unlock(&state->lock);
+    }
+    free(line);
+}
+
+long run_batch(Graph* campus, BuildingMapping* mapping, FILE* in, FILE* out,
+               int num_workers, BatchOrder order) {
+    if (num_workers <= 0) num_workers = omp_get_num_procs();
+
+    BatchState state;
+    memset(&state, 0, sizeof(state));
+    state.in = in;
+    state.out = out;
+    state.order = order;
+    state.next_id = 1;
+    state.next_out = 1;
+    state.window = (long)num_workers * BATCH_WINDOW_PER_WORKER;
+    state.slots = calloc((size_t)state.window, sizeof(BatchSlot));
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.space, NULL);
+
+    LOG_INFO("batch: %d workers, %s order", num_workers, order == BATCH_ORDER_INPUT ? "input" : "any");
+    double start = omp_get_wtime();
+
+    #pragma omp parallel num_threads(num_workers)
+    batch_worker(&state, campus, mapping);
+
+    if (fflush(out) != 0) state.write_failed = 1;
+    double seconds = omp_get_wtime() - start;
+    LOG_INFO("batch: %ld queries in %.3f s (%.0f / s)", state.answered, seconds,
+             seconds > 0 ? state.answered / seconds : 0.0);
+
+    pthread_cond_destroy(&state.space);
+    pthread_mutex_destroy(&state.lock);
+    free(state.slots);
+    return state.write_failed ? -1 : state.answered;
+}
@@ -0,0 +1,264 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <omp.h>
+#include "graph.h"
+#include "astar.h"
+#include "cache.h"
+
+/*
+* entry = header + key bytes + value bytes in one allocation
+* buckets: chained hash table, doubled when entries outnumber buckets
+* recency: doubly linked list, head = most recently used, evict from tail
+*/
+
+typedef struct LruEntry {
+    struct LruEntry* prev;  // recency list
+    struct LruEntry* next;
+    struct LruEntry* chain; // hash bucket
+    uint64_t hash;
+    size_t key_len;
+    size_t value_len;
+    unsigned char data[];   // key, then value
+} LruEntry;
+
+struct LruCache {
+    omp_lock_t lock;
+    LruEntry** buckets;
+    size_t num_buckets;     // power of two
+    LruEntry* head;
+    LruEntry* tail;
+    size_t entries;
+    size_t bytes;
+    size_t max_bytes;
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+};
+
+/******************************************************
+ * LRU cache
+ ******************************************************/
+
+static uint64_t hash_bytes(const void* data, size_t len) {
+    const unsigned char* p = data;
+    uint64_t h = 1469598103934665603ULL; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+static size_t entry_bytes(size_t key_len, size_t value_len) {
+    return sizeof(LruEntry) + key_len + value_len;
+}
+
+LruCache* lru_create(size_t max_bytes) {
+    LruCache* cache = calloc(1, sizeof(LruCache));
+    omp_init_lock(&cache->lock);
+    cache->num_buckets = 64;
+    cache->buckets = calloc(cache->num_buckets, sizeof(LruEntry*));
+    cache->max_bytes = max_bytes;
+    return cache;
+}
+
+void lru_free(LruCache* cache) {
+    if (!cache) return;
+    LruEntry* e = cache->head;
+    while (e) {
+        LruEntry* next = e->next;
+        free(e);
+        e = next;
+    }
+    free(cache->buckets);
+    omp_destroy_lock(&cache->lock);
+    free(cache);
+}
+
+static LruEntry** find_slot(LruCache* cache, uint64_t hash, const void* key, size_t key_len) {
+    LruEntry** slot = &cache->buckets[hash & (cache->num_buckets - 1)];
+    while (*slot) {
+        LruEntry* e = *slot;
+        if (e->hash == hash && e->key_len == key_len && memcmp(e->data, key, key_len) == 0) break;
+        slot = &e->chain;
+    }
+    return slot;
+}
+
+static void list_unlink(LruCache* cache, LruEntry* e) {
+    if (e->prev) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+}
+
+static void list_push_front(LruCache* cache, LruEntry* e) {
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head) cache->head->prev = e;
+    cache->head = e;
+    if (!cache->tail) cache->tail = e;
+}
+
+// Unlink from both structures and free
+static void remove_entry(LruCache* cache, LruEntry* e) {
+    LruEntry** slot = find_slot(cache, e->hash, e->data, e->key_len);
+    *slot = e->chain;
+    list_unlink(cache, e);
+    cache->entries--;
+    cache->bytes -= entry_bytes(e->key_len, e->value_len);
+    free(e);
+}
+
+static void grow_buckets(LruCache* cache) {
+    size_t n = cache->num_buckets * 2;
+    LruEntry** buckets = calloc(n, sizeof(LruEntry*));
+    for (LruEntry* e = cache->head; e; e = e->next) {
+        size_t b = e->hash & (n - 1);
+        e->chain = buckets[b];
+        buckets[b] = e;
+    }
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->num_buckets = n;
+}
+
+int lru_get(LruCache* cache, const void* key, size_t key_len, void** out, size_t* out_len) {
+    uint64_t hash = hash_bytes(key, key_len);
+    int hit = 0;
+
+    omp_set_lock(&cache->lock);
+    LruEntry* e = *find_slot(cache, hash, key, key_len);
+    if (e) {
+        list_unlink(cache, e);
+        list_push_front(cache, e);
+        *out = malloc(e->value_len + 1);
+        memcpy(*out, e->data + e->key_len, e->value_len);
+        *out_len = e->value_len;
+        cache->hits++;
+        hit = 1;
+    } else {
+        cache->misses++;
+    }
+    omp_unset_lock(&cache->lock);
+    return hit;
+}
+
+void lru_put(LruCache* cache, const void* key, size_t key_len, const void* value, size_t value_len) {
+    size_t size = entry_bytes(key_len, value_len);
+    if (size > cache->max_bytes) return;
+
+    // copy outside the lock
+    LruEntry* entry = malloc(size);
+    entry->hash = hash_bytes(key, key_len);
+    entry->key_len = key_len;
+    entry->value_len = value_len;
+    memcpy(entry->data, key, key_len);
+    memcpy(entry->data + key_len, value, value_len);
+
+    omp_set_lock(&cache->lock);
+    LruEntry* old = *find_slot(cache, entry->hash, key, key_len);
+    if (old) remove_entry(cache, old);
+
+    while (cache->bytes + size > cache->max_bytes && cache->tail) {
+        remove_entry(cache, cache->tail);
+        cache->evictions++;
+    }
+
+    if (cache->entries + 1 > cache->num_buckets) grow_buckets(cache);
+    LruEntry** slot = &cache->buckets[entry->hash & (cache->num_buckets - 1)];
+    entry->chain = *slot;
+    *slot = entry;
+    list_push_front(cache, entry);
+    cache->entries++;
+    cache->bytes += size;
+    omp_unset_lock(&cache->lock);
+}
+
+void lru_stats(LruCache* cache, LruStats* out) {
+    omp_set_lock(&cache->lock);
+    out->hits = cache->hits;
+    out->misses = cache->misses;
+    out->evictions = cache->evictions;
+    out->entries = cache->entries;
+    out->bytes = cache->bytes;
+    out->max_bytes = cache->max_bytes;
+    omp_unset_lock(&cache->lock);
+}
+
+/******************************************************
+ * Leg cache
+ ******************************************************/
+
+static LruCache* leg_cache = NULL;
+
+// Key of one leg; the function pointer tells the engines apart for the life of the process
+typedef struct {
+    PathSearchFn search;
+    int start_id;
+    int goal_id;
+} LegKey;
+
+void leg_cache_enable(size_t max_bytes) {
+    leg_cache_disable();
+    if (max_bytes > 0) leg_cache = lru_create(max_bytes);
+}
+
+void leg_cache_disable(void) {
+    lru_free(leg_cache);
+    leg_cache = NULL;
+}
+
+int leg_cache_stats(LruStats* out) {
+    if (!leg_cache) return 0;
+    lru_stats(leg_cache, out);
+    return 1;
+}
+
+double cached_search(PathSearchFn search, Graph* graph, int start_id, int goal_id,
+                     int** out_path, int* out_len) {
+    if (!leg_cache) return search(graph, start_id, goal_id, out_path, out_len);
+
+    LegKey key;
+    memset(&key, 0, sizeof(key)); // padding is part of the key bytes
+    key.search = search;
+    key.start_id = start_id;
+    key.goal_id = goal_id;
+
+    // value: distance, node count, nodes
+    void* value;
+    size_t value_len;
+    if (lru_get(leg_cache, &key, sizeof(key), &value, &value_len)) {
+        double dist;
+        int len;
+        memcpy(&dist, value, sizeof(double));
+        memcpy(&len, (char*)value + sizeof(double), sizeof(int));
+        *out_len = len;
+        *out_path = NULL;
+        if (len > 0) {
+            *out_path = malloc(sizeof(int) * len);
+            memcpy(*out_path, (char*)value + sizeof(double) + sizeof(int), sizeof(int) * len);
+        }
+        free(value);
+        return dist;
+    }
+
+    int* path = NULL;
+    int len = 0;
+    double dist = search(graph, start_id, goal_id, &path, &len);
+    if (!path) len = 0;
+
+    value_len = sizeof(double) + sizeof(int) + sizeof(int) * (size_t)len;
+    value = malloc(value_len);
+    memcpy(value, &dist, sizeof(double));
+    memcpy((char*)value + sizeof(double), &len, sizeof(int));
+    if (len > 0) memcpy((char*)value + sizeof(double) + sizeof(int), path, sizeof(int) * len);
+    lru_put(leg_cache, &key, sizeof(key), value, value_len);
+    free(value);
+
+    *out_path = path;
+    *out_len = len;
+    return dist;
+}
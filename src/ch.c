@@ -0,0 +1,543 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <float.h>
+#include <sys/stat.h>
+#include "graph.h"
+#include "astar.h"
+#include "search_context.h"
+#include "ch.h"
+
+/*
+* preprocessing:
+*   priority(v) = shortcuts needed - edges removed + contracted neighbors (edge difference)
+*   contract the node with the lowest priority (lazy updates), add a shortcut
+*   u -> x for every in/out pair unless a witness search finds a path u ~> x
+*   that avoids v and is not longer
+* query:
+*   Dijkstra upwards from start and (backwards) upwards from goal,
+*   the best meeting node gives the distance, shortcuts unpack recursively
+*/
+
+#define CH_MAGIC "BUZZCH"
+#define CH_VERSION 2
+#define WITNESS_SETTLE_LIMIT 500 // a failed witness search only costs an extra shortcut
+
+/******************************************************
+ * Dynamic graph used while contracting
+ ******************************************************/
+typedef struct {
+    int node;
+    double weight;
+    int middle;
+} CHEdge;
+
+typedef struct {
+    CHEdge* items;
+    int count;
+    int cap;
+} CHEdgeList;
+
+// Insert node into the list, or lower the weight of the existing edge to it
+static void edge_list_set(CHEdgeList* list, int node, double weight, int middle) {
+    for (int i = 0; i < list->count; i++) {
+        if (list->items[i].node == node) {
+            if (weight < list->items[i].weight) {
+                list->items[i].weight = weight;
+                list->items[i].middle = middle;
+            }
+            return;
+        }
+    }
+    if (list->count == list->cap) {
+        list->cap = list->cap ? list->cap * 2 : 4;
+        list->items = realloc(list->items, sizeof(CHEdge) * list->cap);
+    }
+    list->items[list->count].node = node;
+    list->items[list->count].weight = weight;
+    list->items[list->count].middle = middle;
+    list->count++;
+}
+
+typedef struct {
+    int n;
+    CHEdgeList* out;
+    CHEdgeList* in;
+    char* contracted;
+    int* deleted_neighbors;
+
+    // witness search scratch space, reset through the touched list
+    double* dist;
+    int* touched;
+    int touched_count;
+    PQueue heap;
+} CHBuilder;
+
+// Bounded Dijkstra from source in the remaining graph, never entering skip
+static void witness_search(CHBuilder* b, int source, int skip, double limit) {
+    pq_clear(&b->heap);
+    b->dist[source] = 0.0;
+    b->touched[b->touched_count++] = source;
+    pq_push(&b->heap, source, 0.0);
+
+    int settled = 0;
+    while (!pq_empty(&b->heap)) {
+        double du;
+        int u = pq_pop(&b->heap, &du);
+        if (du > limit || ++settled > WITNESS_SETTLE_LIMIT) break;
+
+        CHEdgeList* out = &b->out[u];
+        for (int i = 0; i < out->count; i++) {
+            int x = out->items[i].node;
+            if (x == skip || b->contracted[x]) continue;
+            double nd = du + out->items[i].weight;
+            if (nd < b->dist[x]) {
+                if (b->dist[x] == DBL_MAX) b->touched[b->touched_count++] = x;
+                b->dist[x] = nd;
+                pq_push(&b->heap, x, nd);
+            }
+        }
+    }
+}
+
+static void witness_reset(CHBuilder* b) {
+    for (int i = 0; i < b->touched_count; i++) b->dist[b->touched[i]] = DBL_MAX;
+    b->touched_count = 0;
+}
+
+// Shortcuts needed to contract v; adds them unless simulating
+static int contract_node(CHBuilder* b, int v, int simulate) {
+    int shortcuts = 0;
+    CHEdgeList* in = &b->in[v];
+    CHEdgeList* out = &b->out[v];
+
+    for (int i = 0; i < in->count; i++) {
+        int u = in->items[i].node;
+        if (b->contracted[u]) continue;
+        double w_uv = in->items[i].weight;
+
+        double limit = -1.0;
+        for (int j = 0; j < out->count; j++) {
+            int x = out->items[j].node;
+            if (x == u || b->contracted[x]) continue;
+            if (w_uv + out->items[j].weight > limit) limit = w_uv + out->items[j].weight;
+        }
+        if (limit < 0.0) continue;
+
+        witness_search(b, u, v, limit);
+        for (int j = 0; j < out->count; j++) {
+            int x = out->items[j].node;
+            if (x == u || b->contracted[x]) continue;
+            double via = w_uv + out->items[j].weight;
+            if (b->dist[x] <= via) continue; // witness path found
+
+            shortcuts++;
+            if (!simulate) {
+                edge_list_set(&b->out[u], x, via, v);
+                edge_list_set(&b->in[x], u, via, v);
+            }
+        }
+        witness_reset(b);
+    }
+    return shortcuts;
+}
+
+static int live_degree(CHBuilder* b, CHEdgeList* list) {
+    int d = 0;
+    for (int i = 0; i < list->count; i++) {
+        if (!b->contracted[list->items[i].node]) d++;
+    }
+    return d;
+}
+
+static double node_priority(CHBuilder* b, int v) {
+    int removed = live_degree(b, &b->in[v]) + live_degree(b, &b->out[v]);
+    return (double)(contract_node(b, v, 1) - removed + b->deleted_neighbors[v]);
+}
+
+// Copy the live edges of a list (edges to not-yet-contracted nodes)
+static void keep_live_edges(CHBuilder* b, CHEdgeList* from, CHEdgeList* to) {
+    to->items = NULL;
+    to->count = to->cap = 0;
+    for (int i = 0; i < from->count; i++) {
+        if (!b->contracted[from->items[i].node]) {
+            edge_list_set(to, from->items[i].node, from->items[i].weight, from->items[i].middle);
+        }
+    }
+}
+
+// Pack per-node edge lists into CSR arrays
+static void pack_edges(int n, CHEdgeList* lists, int** offsets, int** nodes, double** weights, int** middle) {
+    int total = 0;
+    for (int v = 0; v < n; v++) total += lists[v].count;
+
+    *offsets = malloc(sizeof(int) * (n + 1));
+    *nodes = malloc(sizeof(int) * (total > 0 ? total : 1));
+    *weights = malloc(sizeof(double) * (total > 0 ? total : 1));
+    *middle = malloc(sizeof(int) * (total > 0 ? total : 1));
+
+    int k = 0;
+    for (int v = 0; v < n; v++) {
+        (*offsets)[v] = k;
+        for (int i = 0; i < lists[v].count; i++, k++) {
+            (*nodes)[k] = lists[v].items[i].node;
+            (*weights)[k] = lists[v].items[i].weight;
+            (*middle)[k] = lists[v].items[i].middle;
+        }
+    }
+    (*offsets)[n] = k;
+}
+
+CHGraph* ch_build(const Graph* g) {
+    int n = g->num_nodes;
+    CHBuilder b;
+    b.n = n;
+    b.out = calloc(n, sizeof(CHEdgeList));
+    b.in = calloc(n, sizeof(CHEdgeList));
+    b.contracted = calloc(n, sizeof(char));
+    b.deleted_neighbors = calloc(n, sizeof(int));
+    b.dist = malloc(sizeof(double) * n);
+    b.touched = malloc(sizeof(int) * n);
+    b.touched_count = 0;
+    pq_init(&b.heap, n, heap_default_kind());
+    for (int v = 0; v < n; v++) b.dist[v] = DBL_MAX;
+
+    // parallel edges collapse to the shortest one, self loops are useless
+    for (int u = 0; u < n; u++) {
+        for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+            int v = g->targets[e];
+            if (v == u) continue;
+            edge_list_set(&b.out[u], v, g->weights[e], -1);
+            edge_list_set(&b.in[v], u, g->weights[e], -1);
+        }
+    }
+
+    CHGraph* ch = malloc(sizeof(CHGraph));
+    ch->num_nodes = n;
+    ch->source_edges = g->num_edges;
+    ch->source_checksum = g->checksum;
+    ch->rank = malloc(sizeof(int) * n);
+
+    CHEdgeList* up = calloc(n, sizeof(CHEdgeList));
+    CHEdgeList* down = calloc(n, sizeof(CHEdgeList));
+
+    // priorities move both ways, so the order needs the general heap
+    PQueue order;
+    pq_init(&order, n, HEAP_DARY);
+    for (int v = 0; v < n; v++) pq_push(&order, v, node_priority(&b, v));
+
+    int next_rank = 0;
+    while (!pq_empty(&order)) {
+        int v = pq_pop(&order, NULL);
+
+        // lazy update: priorities of the remaining nodes may be stale
+        double priority = node_priority(&b, v);
+        if (priority > pq_min_key(&order)) {
+            pq_push(&order, v, priority);
+            continue;
+        }
+
+        ch->rank[v] = next_rank++;
+        keep_live_edges(&b, &b.out[v], &up[v]);
+        keep_live_edges(&b, &b.in[v], &down[v]);
+        contract_node(&b, v, 0);
+        b.contracted[v] = 1;
+
+        for (int i = 0; i < up[v].count; i++) b.deleted_neighbors[up[v].items[i].node]++;
+        for (int i = 0; i < down[v].count; i++) b.deleted_neighbors[down[v].items[i].node]++;
+    }
+
+    pack_edges(n, up, &ch->up_offsets, &ch->up_targets, &ch->up_weights, &ch->up_middle);
+    pack_edges(n, down, &ch->down_offsets, &ch->down_sources, &ch->down_weights, &ch->down_middle);
+
+    for (int v = 0; v < n; v++) {
+        free(b.out[v].items);
+        free(b.in[v].items);
+        free(up[v].items);
+        free(down[v].items);
+    }
+    free(b.out); free(b.in); free(b.contracted); free(b.deleted_neighbors);
+    free(b.dist); free(b.touched); pq_free(&b.heap);
+    pq_free(&order);
+    free(up); free(down);
+    return ch;
+}
+
+void ch_free(CHGraph* ch) {
+    if (!ch) return;
+    free(ch->rank);
+    free(ch->up_offsets); free(ch->up_targets); free(ch->up_weights); free(ch->up_middle);
+    free(ch->down_offsets); free(ch->down_sources); free(ch->down_weights); free(ch->down_middle);
+    free(ch);
+}
+
+/******************************************************
+ * File format
+ ******************************************************/
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t num_nodes;
+    int32_t source_edges;
+    int32_t num_up;
+    int32_t num_down;
+    uint64_t source_checksum;
+} CHFileHeader;
+
+// Bytes a file with this header must have
+static uint64_t ch_file_size(const CHFileHeader* h) {
+    uint64_t nodes = (uint64_t)h->num_nodes;
+    uint64_t per_edge = 2 * sizeof(int32_t) + sizeof(double); // target/source, middle, weight
+    return sizeof(CHFileHeader) + nodes * sizeof(int32_t) + 2 * (nodes + 1) * sizeof(int32_t) +
+           ((uint64_t)h->num_up + (uint64_t)h->num_down) * per_edge;
+}
+
+// Offsets start at 0, never decrease and end at num_edges; every node id is in [0, n)
+// and every middle node in [-1, n)
+static int valid_edges(int n, const int* offsets, int num_edges, const int* nodes,
+                       const double* weights, const int* middle) {
+    if (offsets[0] != 0 || offsets[n] != num_edges) return 0;
+    for (int v = 0; v < n; v++) {
+        if (offsets[v + 1] < offsets[v]) return 0;
+    }
+    for (int e = 0; e < num_edges; e++) {
+        if (nodes[e] < 0 || nodes[e] >= n || middle[e] < -1 || middle[e] >= n || !(weights[e] >= 0)) return 0;
+    }
+    return 1;
+}
+
+static int valid_hierarchy(const CHGraph* ch, int num_up, int num_down) {
+    int n = ch->num_nodes;
+    for (int v = 0; v < n; v++) {
+        if (ch->rank[v] < 0 || ch->rank[v] >= n) return 0;
+    }
+    return valid_edges(n, ch->up_offsets, num_up, ch->up_targets, ch->up_weights, ch->up_middle) &&
+           valid_edges(n, ch->down_offsets, num_down, ch->down_sources, ch->down_weights, ch->down_middle);
+}
+
+int ch_write(const char* filename, const CHGraph* ch) {
+    FILE* out = fopen(filename, "wb");
+    if (!out) {
+        fprintf(stderr, "\033[31m:( Failed creating hierarchy file '%s'\n", filename);
+        return -1;
+    }
+
+    int n = ch->num_nodes;
+    CHFileHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CH_MAGIC, sizeof(CH_MAGIC));
+    h.version = CH_VERSION;
+    h.num_nodes = n;
+    h.source_edges = ch->source_edges;
+    h.source_checksum = ch->source_checksum;
+    h.num_up = ch->up_offsets[n];
+    h.num_down = ch->down_offsets[n];
+
+    size_t up = (size_t)h.num_up, down = (size_t)h.num_down, nodes = (size_t)n;
+    int failed = fwrite(&h, sizeof(h), 1, out) != 1;
+    failed = failed || fwrite(ch->rank, sizeof(int), nodes, out) != nodes;
+    failed = failed || fwrite(ch->up_offsets, sizeof(int), nodes + 1, out) != nodes + 1;
+    failed = failed || fwrite(ch->up_targets, sizeof(int), up, out) != up;
+    failed = failed || fwrite(ch->up_weights, sizeof(double), up, out) != up;
+    failed = failed || fwrite(ch->up_middle, sizeof(int), up, out) != up;
+    failed = failed || fwrite(ch->down_offsets, sizeof(int), nodes + 1, out) != nodes + 1;
+    failed = failed || fwrite(ch->down_sources, sizeof(int), down, out) != down;
+    failed = failed || fwrite(ch->down_weights, sizeof(double), down, out) != down;
+    failed = failed || fwrite(ch->down_middle, sizeof(int), down, out) != down;
+    failed = fclose(out) != 0 || failed;
+
+    if (failed) {
+        fprintf(stderr, "\033[31m:( Failed writing hierarchy file '%s'\n", filename);
+        remove(filename);
+        return -1;
+    }
+    return 0;
+}
+
+CHGraph* ch_read(const char* filename, const Graph* g) {
+    FILE* in = fopen(filename, "rb");
+    if (!in) return NULL; // no hierarchy built
+
+    CHFileHeader h;
+    if (fread(&h, sizeof(h), 1, in) != 1 || memcmp(h.magic, CH_MAGIC, sizeof(CH_MAGIC)) != 0 ||
+        h.version != CH_VERSION || h.num_nodes != g->num_nodes || h.source_edges != g->num_edges ||
+        h.source_checksum != g->checksum) {
+        fprintf(stderr, "\033[31m:( Hierarchy '%s' does not match the loaded graph\033[0m\n", filename);
+        fclose(in);
+        return NULL;
+    }
+
+    // The sizes decide the allocations below, so they must agree with the file first
+    struct stat st;
+    if (h.num_up < 0 || h.num_down < 0 || fstat(fileno(in), &st) != 0 ||
+        (uint64_t)st.st_size != ch_file_size(&h)) {
+        fprintf(stderr, "\033[31m:( Hierarchy '%s' has a corrupt header\033[0m\n", filename);
+        fclose(in);
+        return NULL;
+    }
+
+    size_t up = (size_t)h.num_up, down = (size_t)h.num_down, nodes = (size_t)h.num_nodes;
+    CHGraph* ch = malloc(sizeof(CHGraph));
+    ch->num_nodes = h.num_nodes;
+    ch->source_edges = h.source_edges;
+    ch->source_checksum = h.source_checksum;
+    ch->rank = malloc(sizeof(int) * (nodes + 1));
+    ch->up_offsets = malloc(sizeof(int) * (nodes + 1));
+    ch->up_targets = malloc(sizeof(int) * (up + 1));
+    ch->up_weights = malloc(sizeof(double) * (up + 1));
+    ch->up_middle = malloc(sizeof(int) * (up + 1));
+    ch->down_offsets = malloc(sizeof(int) * (nodes + 1));
+    ch->down_sources = malloc(sizeof(int) * (down + 1));
+    ch->down_weights = malloc(sizeof(double) * (down + 1));
+    ch->down_middle = malloc(sizeof(int) * (down + 1));
+
+    int failed = fread(ch->rank, sizeof(int), nodes, in) != nodes;
+    failed = failed || fread(ch->up_offsets, sizeof(int), nodes + 1, in) != nodes + 1;
+    failed = failed || fread(ch->up_targets, sizeof(int), up, in) != up;
+    failed = failed || fread(ch->up_weights, sizeof(double), up, in) != up;
+    failed = failed || fread(ch->up_middle, sizeof(int), up, in) != up;
+    failed = failed || fread(ch->down_offsets, sizeof(int), nodes + 1, in) != nodes + 1;
+    failed = failed || fread(ch->down_sources, sizeof(int), down, in) != down;
+    failed = failed || fread(ch->down_weights, sizeof(double), down, in) != down;
+    failed = failed || fread(ch->down_middle, sizeof(int), down, in) != down;
+    fclose(in);
+
+    if (failed) {
+        fprintf(stderr, "\033[31m:( Hierarchy '%s' is truncated\033[0m\n", filename);
+        ch_free(ch);
+        return NULL;
+    }
+    if (!valid_hierarchy(ch, h.num_up, h.num_down)) {
+        fprintf(stderr, "\033[31m:( Hierarchy '%s' has out-of-range offsets or node ids\033[0m\n", filename);
+        ch_free(ch);
+        return NULL;
+    }
+
+    fprintf(stderr, "\033[32m:) Loaded contraction hierarchy '%s' (%d up, %d down edges)\033[0m\n",
+            filename, h.num_up, h.num_down);
+    return ch;
+}
+
+/******************************************************
+ * Query
+ ******************************************************/
+typedef struct {
+    int* data;
+    int size;
+    int cap;
+} IntVec;
+
+static void intvec_push(IntVec* v, int x) {
+    if (v->size == v->cap) {
+        v->cap = v->cap ? v->cap * 2 : 64;
+        v->data = realloc(v->data, sizeof(int) * v->cap);
+    }
+    v->data[v->size++] = x;
+}
+
+// Append the original nodes of edge from -> to (excluding from, including to)
+static void unpack_edge(const CHGraph* ch, int from, int to, int middle, IntVec* path) {
+    if (middle < 0) {
+        intvec_push(path, to);
+        return;
+    }
+
+    // from -> middle is a downward edge stored at middle, middle -> to an upward one
+    int first_middle = -1, second_middle = -1;
+    for (int e = ch->down_offsets[middle]; e < ch->down_offsets[middle + 1]; e++) {
+        if (ch->down_sources[e] == from) { first_middle = ch->down_middle[e]; break; }
+    }
+    for (int e = ch->up_offsets[middle]; e < ch->up_offsets[middle + 1]; e++) {
+        if (ch->up_targets[e] == to) { second_middle = ch->up_middle[e]; break; }
+    }
+
+    unpack_edge(ch, from, middle, first_middle, path);
+    unpack_edge(ch, middle, to, second_middle, path);
+}
+
+double ch_query(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len) {
+    const CHGraph* ch = graph->ch;
+    if (!ch) return astar_bidirectional(graph, start_id, goal_id, out_path, out_len);
+
+    if (start_id == goal_id) {
+        *out_path = malloc(sizeof(int));
+        (*out_path)[0] = start_id;
+        *out_len = 1;
+        return 0.0;
+    }
+
+    // parent: previous node of the search tree (towards start / towards goal)
+    // parent_edge: index into the up array (forward) or the down array (backward)
+    SearchContext* ctx = search_context_acquire(graph);
+    search_context_begin(ctx);
+
+    sc_set(ctx, 0, start_id, 0.0, -1, -1);
+    sc_set(ctx, 1, goal_id, 0.0, -1, -1);
+    pq_push(&ctx->side[0].heap, start_id, 0.0);
+    pq_push(&ctx->side[1].heap, goal_id, 0.0);
+
+    double best = DBL_MAX;
+    int meeting = -1;
+
+    for (;;) {
+        // each side stops once its smallest key cannot improve the best meeting
+        double key0 = pq_min_key(&ctx->side[0].heap);
+        double key1 = pq_min_key(&ctx->side[1].heap);
+        if (key0 >= best && key1 >= best) break;
+        int side = key0 <= key1 ? 0 : 1;
+        int other = 1 - side;
+
+        int u = pq_pop(&ctx->side[side].heap, NULL);
+        sc_settled(ctx);
+
+        const int* offsets = side == 0 ? ch->up_offsets : ch->down_offsets;
+        const int* adjacent = side == 0 ? ch->up_targets : ch->down_sources;
+        const double* weights = side == 0 ? ch->up_weights : ch->down_weights;
+
+        double du = sc_dist(ctx, side, u);
+        STAT_ADD(STAT_EDGES_RELAXED, offsets[u + 1] - offsets[u]);
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            int v = adjacent[e];
+            double nd = du + weights[e];
+            if (nd >= sc_dist(ctx, side, v)) continue;
+            sc_set(ctx, side, v, nd, u, e);
+            pq_push(&ctx->side[side].heap, v, nd);
+
+            double other_d = sc_dist(ctx, other, v);
+            if (other_d != DBL_MAX && nd + other_d < best) {
+                best = nd + other_d;
+                meeting = v;
+            }
+        }
+    }
+
+    if (meeting == -1) {
+        *out_path = NULL;
+        *out_len = 0;
+        return DBL_MAX;
+    }
+
+    // Collect the upward edges start -> meeting (reversed) and the downward edges meeting -> goal
+    IntVec up_edges = {NULL, 0, 0}, path = {NULL, 0, 0};
+    for (int v = meeting; v != start_id; v = sc_parent(ctx, 0, v)) {
+        intvec_push(&up_edges, ctx->side[0].parent_edge[v]);
+    }
+
+    intvec_push(&path, start_id);
+    int from = start_id;
+    for (int i = up_edges.size - 1; i >= 0; i--) {
+        int e = up_edges.data[i];
+        unpack_edge(ch, from, ch->up_targets[e], ch->up_middle[e], &path);
+        from = ch->up_targets[e];
+    }
+    for (int v = meeting; v != goal_id; v = sc_parent(ctx, 1, v)) {
+        // the downward edge v -> parent is stored at its lower end
+        unpack_edge(ch, v, sc_parent(ctx, 1, v), ch->down_middle[ctx->side[1].parent_edge[v]], &path);
+    }
+
+    free(up_edges.data);
+    *out_path = path.data;
+    *out_len = path.size;
+    return best;
+}
@@ -1,30 +1,126 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stdint.h>
 #include "graph.h"
+#include "logging.h"
 
 Graph *create_graph(int num_nodes)
 { // Initialize graph represented by adjacency list
     Graph *g = malloc(sizeof(Graph));
     g->num_nodes = num_nodes;
-    g->nodes = malloc(num_nodes * sizeof(Node));
-    for (int i = 0; i < num_nodes; i++)
-    {
-        g->nodes[i].id = i;
-        g->nodes[i].neighbors = NULL;
-    }
+    g->num_edges = 0;
+    g->adjacency = calloc(num_nodes, sizeof(Edge *));
+    g->offsets = NULL;
+    g->targets = NULL;
+    g->weights = NULL;
+    g->rev_offsets = NULL;
+    g->rev_sources = NULL;
+    g->rev_weights = NULL;
+    g->lat = calloc(num_nodes, sizeof(double));
+    g->lon = calloc(num_nodes, sizeof(double));
+    g->checksum = 0;
+    g->ch = NULL;
+    g->landmarks = NULL;
+    g->edge_grid = NULL;
     return g;
 }
 
 void add_edge(Graph *g, int from, int to, double weight)
-{ // Add directed edge
+{ // Add directed edge (only valid before the graph is frozen)
     Edge *e = malloc(sizeof(Edge));
     e->to = to;
     e->weight = weight;
 
     // inset edge into linked list
-    e->next = g->nodes[from].neighbors;
-    g->nodes[from].neighbors = e;
+    e->next = g->adjacency[from];
+    g->adjacency[from] = e;
+    g->num_edges++;
+}
+
+#define FNV_PRIME 1099511628211ULL
+
+uint64_t fnv1a(uint64_t hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+    for (size_t i = 0; i < len; i++)
+    {
+        hash ^= p[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+uint64_t graph_checksum(const Graph *g)
+{
+    uint64_t hash = fnv1a(FNV_OFFSET, g->offsets, ((size_t)g->num_nodes + 1) * sizeof(int));
+    hash = fnv1a(hash, g->targets, (size_t)g->num_edges * sizeof(int));
+    return fnv1a(hash, g->weights, (size_t)g->num_edges * sizeof(double));
+}
+
+// Build the reverse CSR (in-edges per node) from the forward CSR arrays
+static void build_reverse_csr(Graph *g)
+{
+    int n = g->num_nodes;
+    int m = g->num_edges;
+    g->rev_offsets = calloc(n + 1, sizeof(int));
+    g->rev_sources = malloc((m > 0 ? m : 1) * sizeof(int));
+    g->rev_weights = malloc((m > 0 ? m : 1) * sizeof(double));
+
+    // count in-degrees, then prefix sum into offsets
+    for (int e = 0; e < m; e++)
+        g->rev_offsets[g->targets[e] + 1]++;
+    for (int v = 0; v < n; v++)
+        g->rev_offsets[v + 1] += g->rev_offsets[v];
+
+    int *fill = malloc((n > 0 ? n : 1) * sizeof(int));
+    memcpy(fill, g->rev_offsets, n * sizeof(int));
+    for (int u = 0; u < n; u++)
+    {
+        for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++)
+        {
+            int k = fill[g->targets[e]]++;
+            g->rev_sources[k] = u;
+            g->rev_weights[k] = g->weights[e];
+        }
+    }
+    free(fill);
+}
+
+// Convert the adjacency lists into contiguous CSR arrays and release the lists
+// Edge order within a node is kept, so searches visit neighbors as before
+void freeze_graph(Graph *g)
+{
+    if (!g->adjacency)
+        return; // already frozen
+
+    g->offsets = malloc((g->num_nodes + 1) * sizeof(int));
+    g->targets = malloc((g->num_edges > 0 ? g->num_edges : 1) * sizeof(int));
+    g->weights = malloc((g->num_edges > 0 ? g->num_edges : 1) * sizeof(double));
+
+    int k = 0;
+    for (int i = 0; i < g->num_nodes; i++)
+    {
+        g->offsets[i] = k;
+        Edge *e = g->adjacency[i];
+        while (e)
+        {
+            Edge *temp = e;
+            g->targets[k] = e->to;
+            g->weights[k] = e->weight;
+            k++;
+            e = e->next;
+            free(temp);
+        }
+    }
+    g->offsets[g->num_nodes] = k;
+
+    free(g->adjacency);
+    g->adjacency = NULL;
+
+    build_reverse_csr(g);
+    g->checksum = graph_checksum(g);
 }
 
 Graph *load_graph(const char *filename)
@@ -62,9 +158,10 @@ Graph *load_graph(const char *filename)
     {
         add_edge(g, from, to, weight);
     }
+    freeze_graph(g);
 
     fclose(input);
-    fprintf(stdout, "\033[32m:) Load campus graph successfully\n");
+    fprintf(stderr, "\033[32m:) Load campus graph successfully\n");
     return g;
 }
 
@@ -87,13 +184,13 @@ int load_node_coordinates(Graph *g, const char *filename)
     {
         if (node_id >= 0 && node_id < g->num_nodes)
         {
-            g->nodes[node_id].lat = lat;
-            g->nodes[node_id].lon = lon;
+            g->lat[node_id] = lat;
+            g->lon[node_id] = lon;
         }
     }
 
     fclose(input);
-    fprintf(stdout, "\033[32m:) Load node coordinates successfully (using x as lon, y as lat)\n");
+    fprintf(stderr, "\033[32m:) Load node coordinates successfully (using x as lon, y as lat)\n");
     return 0;
 }
 
@@ -102,35 +199,44 @@ void print_graph(const Graph *g)
 {
     for (int i = 0; i < g->num_nodes; i++)
     {
-        Edge *e = g->nodes[i].neighbors;
-        if (e)
+        if (g->offsets[i] < g->offsets[i + 1])
         {
-            printf("Node %d:", i);
-            while (e)
+            fprintf(stderr, "Node %d:", i);
+            for (int e = g->offsets[i]; e < g->offsets[i + 1]; e++)
             {
-                printf(" -> %d(%.2f)", e->to, e->weight);
-                e = e->next;
+                fprintf(stderr, " -> %d(%.2f)", g->targets[e], g->weights[e]);
             }
-            printf("\n");
+            fprintf(stderr, "\n");
         }
     }
 }
 
 void free_graph(Graph *g)
 {
-    for (int i = 0; i < g->num_nodes; i++)
-    {
-        Edge *e = g->nodes[i].neighbors;
-        while (e)
+    if (g->adjacency)
+    { // never frozen
+        for (int i = 0; i < g->num_nodes; i++)
         {
-            Edge *temp = e;
-            e = e->next;
-            free(temp);
+            Edge *e = g->adjacency[i];
+            while (e)
+            {
+                Edge *temp = e;
+                e = e->next;
+                free(temp);
+            }
         }
+        free(g->adjacency);
     }
-    free(g->nodes);
+    free(g->offsets);
+    free(g->targets);
+    free(g->weights);
+    free(g->rev_offsets);
+    free(g->rev_sources);
+    free(g->rev_weights);
+    free(g->lat);
+    free(g->lon);
     free(g);
-    fprintf(stdout, "\033[32m:) Free campus graph\n");
+    fprintf(stderr, "\033[32m:) Free campus graph\n");
 }
 
 BuildingMapping *load_building(const char *filename)
@@ -142,51 +248,168 @@ BuildingMapping *load_building(const char *filename)
         return NULL;
     }
 
-    char buffer[256];
-    char name[200];
-    int id;
+    char buffer[512];
 
     BuildingMapping *mapping = malloc(sizeof(BuildingMapping));
-    mapping->entries = malloc(MAX_BUILDINGS * sizeof(BuildingEntry));
+    mapping->capacity = 256;
+    mapping->entries = malloc(mapping->capacity * sizeof(BuildingEntry));
     mapping->count = 0;
-    mapping->capacity = MAX_BUILDINGS;
+    mapping->grid = NULL;
 
     fgets(buffer, sizeof(buffer), input); // ignore header
 
     while (fgets(buffer, sizeof(buffer), input))
     {
-        char *token = strtok(buffer, ","); // split string by ","
-        if (!token)
+        char *name = strtok(buffer, ","); // split string by ","
+        if (!name)
             continue;
-        strcpy(name, token);
-        token = strtok(NULL, ",");
+        char *token = strtok(NULL, ",");
         if (!token)
             continue;
-        id = atoi(token); // convert to int
 
+        if (mapping->count == mapping->capacity)
+        {
+            mapping->capacity *= 2;
+            mapping->entries = realloc(mapping->entries, mapping->capacity * sizeof(BuildingEntry));
+        }
         mapping->entries[mapping->count].name = strdup(name);
-        mapping->entries[mapping->count].node_id = id;
+        mapping->entries[mapping->count].node_id = atoi(token); // convert to int
         mapping->count++;
     }
 
     fclose(input);
+    index_buildings(mapping);
     return mapping;
 }
 
+/******************************************************
+ * Building index
+ ******************************************************/
+
+static uint32_t hash_name(const char *name)
+{
+    uint32_t h = 2166136261u; // FNV-1a
+    for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+    {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+// qsort has no context argument: the entries being sorted are parked here
+static const BuildingEntry *sort_entries;
+
+static int compare_names(const void *a, const void *b)
+{
+    int ia = *(const int *)a, ib = *(const int *)b;
+    int c = strcasecmp(sort_entries[ia].name, sort_entries[ib].name);
+    return c != 0 ? c : ia - ib;
+}
+
+void index_buildings(BuildingMapping *mapping)
+{
+    BuildingIndex *index = &mapping->index;
+    int n = mapping->count;
+
+    // 1. name hash table (first entry wins on duplicate names, as the old linear scan did)
+    index->num_slots = 16;
+    while (index->num_slots < 2 * n)
+        index->num_slots *= 2;
+    index->slots = malloc(index->num_slots * sizeof(int));
+    for (int s = 0; s < index->num_slots; s++)
+        index->slots[s] = -1;
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t s = hash_name(mapping->entries[i].name) & (index->num_slots - 1);
+        while (index->slots[s] >= 0 && strcmp(mapping->entries[index->slots[s]].name, mapping->entries[i].name) != 0)
+            s = (s + 1) & (index->num_slots - 1);
+        if (index->slots[s] < 0)
+            index->slots[s] = i;
+    }
+
+    // 2. node -> building
+    index->num_nodes = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (mapping->entries[i].node_id + 1 > index->num_nodes)
+            index->num_nodes = mapping->entries[i].node_id + 1;
+    }
+    index->by_node = malloc((index->num_nodes + 1) * sizeof(int));
+    for (int v = 0; v < index->num_nodes; v++)
+        index->by_node[v] = -1;
+    for (int i = 0; i < n; i++)
+    {
+        int v = mapping->entries[i].node_id;
+        if (v >= 0 && index->by_node[v] < 0)
+            index->by_node[v] = i;
+    }
+
+    // 3. name order for prefix search
+    index->sorted = malloc((n + 1) * sizeof(int));
+    for (int i = 0; i < n; i++)
+        index->sorted[i] = i;
+    sort_entries = mapping->entries;
+    qsort(index->sorted, n, sizeof(int), compare_names);
+}
+
+void free_building_index(BuildingMapping *mapping)
+{
+    free(mapping->index.slots);
+    free(mapping->index.by_node);
+    free(mapping->index.sorted);
+    memset(&mapping->index, 0, sizeof(mapping->index));
+}
+
 int get_building_id(const BuildingMapping *mapping, const char *name)
 {
-    for (int i = 0; i < mapping->count; i++)
+    const BuildingIndex *index = &mapping->index;
+    uint32_t s = hash_name(name) & (index->num_slots - 1);
+    while (index->slots[s] >= 0)
     {
-        if (strcmp(mapping->entries[i].name, name) == 0)
-        {
-            // fprintf(stdout, "\033[32m:) Note down location of %s:", name);
-            return mapping->entries[i].node_id;
-        }
+        const BuildingEntry *entry = &mapping->entries[index->slots[s]];
+        if (strcmp(entry->name, name) == 0)
+            return entry->node_id;
+        s = (s + 1) & (index->num_slots - 1);
     }
-    fprintf(stderr, "\033[31m:(\033[0m Building %s not found in mapping", name);
+    LOG_WARN("building %s not found in mapping", name);
     return -1; // no name matching
 }
 
+int get_building_at_node(const BuildingMapping *mapping, int node_id)
+{
+    if (node_id < 0 || node_id >= mapping->index.num_nodes)
+        return -1;
+    return mapping->index.by_node[node_id];
+}
+
+int find_buildings_by_prefix(const BuildingMapping *mapping, const char *prefix,
+                             int max_results, int *out_entries)
+{
+    const int *sorted = mapping->index.sorted;
+    size_t len = strlen(prefix);
+
+    // first name not ordered before the prefix
+    int lo = 0, hi = mapping->count;
+    while (lo < hi)
+    {
+        int mid = lo + (hi - lo) / 2;
+        if (strncasecmp(mapping->entries[sorted[mid]].name, prefix, len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    int found = 0;
+    for (int i = lo; i < mapping->count && found < max_results; i++)
+    {
+        if (strncasecmp(mapping->entries[sorted[i]].name, prefix, len) != 0)
+            break;
+        out_entries[found++] = sorted[i];
+    }
+    return found;
+}
+
 void free_building(BuildingMapping *mapping)
 {
     for (int i = 0; i < mapping->count; i++)
@@ -194,6 +417,7 @@ void free_building(BuildingMapping *mapping)
         free(mapping->entries[i].name);
     }
     free(mapping->entries);
+    free_building_index(mapping);
     free(mapping);
-    fprintf(stdout, "\033[32m:) Free building mapping\n");
-}
\ No newline at end of file
+    fprintf(stderr, "\033[32m:) Free building mapping\n");
+}
@@ -0,0 +1,644 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <float.h>
+#include "graph.h"
+#include "astar.h"
+#include "via_point.h"
+#include "instructions.h"
+#include "tsp.h"
+#include "tsp_heuristic.h"
+#include "matrix.h"
+#include "utils.h"
+#include "snapshot.h"
+#include "ch.h"
+#include "landmarks.h"
+#include "spatial.h"
+#include "cache.h"
+#include "stats.h"
+#include "logging.h"
+#include "handlers.h"
+
+// --- Helper Functions ---
+
+// Set when the resources come from a mapped snapshot instead of the CSV files
+static Snapshot* campus_snapshot = NULL;
+
+// Speed-up structures: the hierarchy is built offline, the building grid is cheap enough to
+// build here, landmarks and the segment grid are built by the first query that needs them
+// (astar_alt, graph_edge_grid)
+static void attach_search_structures(Graph* campus, BuildingMapping* mapping) {
+    campus->ch = ch_read("../data/campus.ch", campus);
+    mapping->grid = spatial_grid_for_buildings(campus, mapping);
+}
+
+// Consolidate resource loading
+static int load_resources(Graph** campus, BuildingMapping** mapping) {
+    // Prefer the binary snapshot: no parsing, pages shared between processes
+    campus_snapshot = open_snapshot("../data/campus.snapshot");
+    if (campus_snapshot) {
+        *campus = &campus_snapshot->graph;
+        *mapping = &campus_snapshot->mapping;
+        attach_search_structures(*campus, *mapping);
+        return 1;
+    }
+
+    LOG_INFO("loading graph data from CSV");
+    
+    *campus = load_graph("../data/adj_list.csv");
+    if (!*campus) return 0;
+
+    if (load_node_coordinates(*campus, "../data/node_coordinates.csv") != 0) {
+        free_graph(*campus);
+        return 0;
+    }
+
+    *mapping = load_building("../data/building_mapping.csv");
+    if (!*mapping) {
+        free_graph(*campus);
+        return 0;
+    }
+
+    attach_search_structures(*campus, *mapping);
+
+    return 1; // Success
+}
+
+// Timed for load_ms of the instrumentation output
+int load_campus_resources(Graph** campus, BuildingMapping** mapping) {
+    double start = stats_now();
+    int ok = load_resources(campus, mapping);
+    stats_set_load_time(stats_now() - start);
+    return ok;
+}
+
+void free_campus_resources(Graph* campus, BuildingMapping* mapping) {
+    ch_free(campus->ch);
+    landmarks_free(campus->landmarks);
+    edge_grid_free(campus->edge_grid);
+    spatial_grid_free(mapping->grid);
+    campus->ch = NULL;
+    campus->landmarks = NULL;
+    campus->edge_grid = NULL;
+    mapping->grid = NULL;
+
+    if (campus_snapshot) {
+        close_snapshot(campus_snapshot);
+        campus_snapshot = NULL;
+        return;
+    }
+    free_building(mapping);
+    free_graph(campus);
+}
+
+// --- Logic Handlers ---
+
+void handle_tsp_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                     const QueryOptions* opts, int argc, char *argv[]) {
+    NavigationResult res;
+    init_result(&res);
+
+    int num_buildings = argc - 2;
+    const char** building_names = (const char**)&argv[2];
+
+    LOG_INFO("tsp: %d buildings", num_buildings);
+
+    // Call TSP Solver
+    int* order = malloc(sizeof(int) * num_buildings);
+    STATS_PHASE_BEGIN(search_start);
+    int result_code = find_optimal_multi_building_route(
+        campus, mapping, building_names, num_buildings, opts->search, &opts->tsp,
+        &res.total_distance, &res.path_node_ids, &res.path_length, order
+    );
+    STATS_PHASE_END(PHASE_SEARCH, search_start);
+
+    if (result_code != 0) {
+        res.status_code = 1;
+        res.error_message = "TSP optimization failed";
+        print_json_response(out, &res, campus, opts->format);
+        free(order);
+        return;
+    }
+
+    // Buildings between the two ends in visiting order (a round trip ends where it starts)
+    int closed = opts->tsp.mode == TSP_MODE_ROUND_TRIP;
+    const char* start_name = building_names[order[0]];
+    const char* end_name = closed ? start_name : building_names[order[num_buildings - 1]];
+    int num_via = closed ? num_buildings - 1 : num_buildings - 2;
+
+    // Legs follow the order, so each via building is the next match along the path
+    if (num_via > 0) {
+        res.via_indices = malloc(sizeof(int) * num_via);
+        int via_count = 0;
+        int j = 1;
+        for (int k = 1; k <= num_via; k++) {
+            int b_id = get_building_id(mapping, building_names[order[k]]);
+            while (j < res.path_length - 1 && res.path_node_ids[j] != b_id) j++;
+            if (j >= res.path_length - 1) break;
+            res.via_indices[via_count++] = j++;
+        }
+        res.num_via_indices = via_count;
+    }
+
+    // Generate Instructions
+    STATS_PHASE_BEGIN(instructions_start);
+    res.instructions = generate_instructions(
+        campus, res.path_node_ids, res.path_length,
+        start_name, end_name,
+        mapping, &res.instruction_count
+    );
+    STATS_PHASE_END(PHASE_INSTRUCTIONS, instructions_start);
+    free(order);
+
+    // Output
+    if (opts->stats) res.stats_mark = &opts->stats_base;
+    print_json_response(out, &res, campus, opts->format);
+    
+    // Cleanup
+    free_result(&res);
+}
+
+void handle_matrix_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                        const QueryOptions* opts, int argc, char *argv[]) {
+    (void)opts; // distances only, the engine follows from what is loaded
+    int num_buildings = argc - 2;
+    const char** building_names = (const char**)&argv[2];
+
+    int* ids = malloc(sizeof(int) * num_buildings);
+    for (int i = 0; i < num_buildings; i++) {
+        ids[i] = get_building_id(mapping, building_names[i]);
+        if (ids[i] == -1) {
+            print_json_error(out, "One of the buildings was not found");
+            free(ids);
+            return;
+        }
+    }
+
+    LOG_INFO("matrix: %d buildings", num_buildings);
+
+    STATS_PHASE_BEGIN(search_start);
+    double* dist = distance_matrix(campus, ids, num_buildings, ids, num_buildings);
+    STATS_PHASE_END(PHASE_SEARCH, search_start);
+    print_json_matrix(out, building_names, num_buildings, dist);
+
+    free(dist);
+    free(ids);
+}
+
+void handle_buildings_mode(FILE* out, BuildingMapping* mapping,
+                           const QueryOptions* opts, int argc, char *argv[]) {
+    const char* prefix = argc > 2 ? argv[2] : "";
+    int max_results = opts->limit > 0 && opts->limit < mapping->count ? opts->limit : mapping->count;
+
+    int* entries = malloc(sizeof(int) * (max_results + 1));
+    int found = find_buildings_by_prefix(mapping, prefix, max_results, entries);
+    print_json_buildings(out, mapping, entries, found);
+    free(entries);
+}
+
+// "lat,lon" -> 0 on success
+static int parse_coordinate(const char* text, double* lat, double* lon) {
+    char* end;
+    *lat = strtod(text, &end);
+    if (end == text || *end != ',') return -1;
+    const char* second = end + 1;
+    *lon = strtod(second, &end);
+    if (end == second || *end != '\0') return -1;
+    return (*lat >= -90 && *lat <= 90 && *lon >= -180 && *lon <= 180) ? 0 : -1;
+}
+
+// Graph node a snapped point lies on (t at either end of its segment), -1 inside the segment
+static int snap_node(const EdgeSnap* snap) {
+    if (snap->t <= 0.0) return snap->from;
+    if (snap->t >= 1.0) return snap->to;
+    return -1;
+}
+
+// Points closer than this draw as one at the 1e-6 degree resolution of the responses
+#define SAME_POINT_METERS 0.5
+
+static int same_position(double lat1, double lon1, double lat2, double lon2) {
+    return haversine(lat1, lon1, lat2, lon2) < SAME_POINT_METERS;
+}
+
+// Whether the snapped point is a point of its own next to path node node_id (-1 = no node)
+static int snap_adds_point(const Graph* campus, const EdgeSnap* snap, int node_id) {
+    if (node_id < 0) return 1;
+    if (snap_node(snap) == node_id) return 0;
+    return !same_position(snap->lat, snap->lon, campus->lat[node_id], campus->lon[node_id]);
+}
+
+// Drop path nodes at the same position as the node before them (e.g. a building node
+// joined to its road node), the response would draw a zero-length segment
+static void drop_colocated_nodes(const Graph* campus, int* path, int* len) {
+    int kept = 0;
+    for (int i = 0; i < *len; i++) {
+        if (kept > 0 && same_position(campus->lat[path[i]], campus->lon[path[i]],
+                                      campus->lat[path[kept - 1]], campus->lon[path[kept - 1]])) continue;
+        path[kept++] = path[i];
+    }
+    *len = kept;
+}
+
+// campus->edge_grid, built by the first coordinate query; later queries only pay an atomic load
+static const EdgeGrid* graph_edge_grid(Graph* campus) {
+    EdgeGrid* eg = __atomic_load_n(&campus->edge_grid, __ATOMIC_ACQUIRE);
+    if (eg) return eg;
+    #pragma omp critical(edge_grid_build)
+    {
+        eg = campus->edge_grid;
+        if (!eg) {
+            eg = edge_grid_build(campus);
+            __atomic_store_n(&campus->edge_grid, eg, __ATOMIC_RELEASE);
+        }
+    }
+    return eg;
+}
+
+void handle_coord_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                       const QueryOptions* opts, int argc, char *argv[]) {
+    (void)argc;
+    double from_lat, from_lon, to_lat, to_lon;
+    if (parse_coordinate(argv[2], &from_lat, &from_lon) != 0 ||
+        parse_coordinate(argv[4], &to_lat, &to_lon) != 0) {
+        print_json_error(out, "Coordinates must be given as lat,lon");
+        return;
+    }
+
+    const EdgeGrid* edges = graph_edge_grid(campus);
+    EdgeSnap from, to;
+    if (snap_to_edge(edges, campus, from_lat, from_lon, SNAP_MAX_DISTANCE, &from) != 0 ||
+        snap_to_edge(edges, campus, to_lat, to_lon, SNAP_MAX_DISTANCE, &to) != 0) {
+        print_json_error(out, "Coordinate is too far from the road network");
+        return;
+    }
+
+    LOG_INFO("routing: (%f, %f) -> (%f, %f), snapped %.1f m / %.1f m",
+            from_lat, from_lon, to_lat, to_lon, from.dist, to.dist);
+
+    NavigationResult res;
+    init_result(&res);
+    STATS_PHASE_BEGIN(search_start);
+    res.total_distance = route_between_snaps(campus, &from, &to, opts->search,
+                                             &res.path_node_ids, &res.path_length);
+    STATS_PHASE_END(PHASE_SEARCH, search_start);
+    if (res.total_distance == DBL_MAX) {
+        print_json_error(out, "No path found");
+        free_result(&res);
+        return;
+    }
+
+    STATS_PHASE_BEGIN(instructions_start);
+    res.instructions = generate_instructions(
+        campus, res.path_node_ids, res.path_length,
+        "your starting point", "your destination", mapping, &res.instruction_count
+    );
+    STATS_PHASE_END(PHASE_INSTRUCTIONS, instructions_start);
+
+    // Drawn geometry only (the instructions above saw every node): co-located nodes
+    // collapse, and a snapped point is drawn unless it falls on the path's end node
+    drop_colocated_nodes(campus, res.path_node_ids, &res.path_length);
+    int first = res.path_length > 0 ? res.path_node_ids[0] : -1;
+    int last = res.path_length > 0 ? res.path_node_ids[res.path_length - 1] : -1;
+    res.has_start = snap_adds_point(campus, &from, first);
+    res.has_end = snap_adds_point(campus, &to, last);
+    if (res.path_length == 0 && same_position(from.lat, from.lon, to.lat, to.lon)) res.has_end = 0;
+    res.start_point[0] = from.lat;
+    res.start_point[1] = from.lon;
+    res.end_point[0] = to.lat;
+    res.end_point[1] = to.lon;
+
+    if (opts->stats) res.stats_mark = &opts->stats_base;
+    print_json_response(out, &res, campus, opts->format);
+    free_result(&res);
+}
+
+void handle_navigation_mode(FILE* out, Graph* campus, BuildingMapping* mapping,
+                            const QueryOptions* opts, int argc, char *argv[]) {
+    NavigationResult res;
+    init_result(&res);
+
+    const char* start_name = argv[1];
+    const char* end_name = argv[argc - 1];
+    int num_via = argc - 3;
+
+    LOG_INFO("routing: %s -> %s (via: %d)", start_name, end_name, num_via);
+
+    int start_id = get_building_id(mapping, start_name);
+    int end_id = get_building_id(mapping, end_name);
+
+    if (start_id == -1 || end_id == -1) {
+        print_json_error(out, "Start or End building not found in mapping");
+        return;
+    }
+
+    // Process Via Points
+    int* via_ids = NULL;
+    if (num_via > 0) {
+        via_ids = malloc(sizeof(int) * num_via);
+        for (int i = 0; i < num_via; i++) {
+            via_ids[i] = get_building_id(mapping, argv[2 + i]);
+            if (via_ids[i] == -1) {
+                print_json_error(out, "One of the via points was not found");
+                free(via_ids);
+                return;
+            }
+        }
+    }
+
+    STATS_PHASE_BEGIN(search_start);
+    if (opts->reorder_via) order_via_points(campus, start_id, end_id, via_ids, num_via);
+
+    // Execute A* (Algorithm is now triggered here, outside main)
+    res.total_distance = astar_via_points(
+        campus, start_id, end_id, via_ids, num_via, 
+        &res.path_node_ids, &res.path_length, opts->search
+    );
+    STATS_PHASE_END(PHASE_SEARCH, search_start);
+
+    if (res.path_node_ids && res.path_length > 0) {
+        // Calculate via indices for UI markers
+        if (num_via > 0) {
+            res.num_via_indices = num_via;
+            res.via_indices = malloc(sizeof(int) * num_via);
+            for (int v = 0; v < num_via; v++) {
+                res.via_indices[v] = -1;
+                for (int i = 0; i < res.path_length; i++) {
+                    if (res.path_node_ids[i] == via_ids[v]) {
+                        res.via_indices[v] = i;
+                        break;
+                    }
+                }
+            }
+        }
+
+        // Generate Instructions
+        STATS_PHASE_BEGIN(instructions_start);
+        res.instructions = generate_instructions(
+            campus, res.path_node_ids, res.path_length,
+            start_name, end_name, mapping, &res.instruction_count
+        );
+        STATS_PHASE_END(PHASE_INSTRUCTIONS, instructions_start);
+
+        if (opts->stats) res.stats_mark = &opts->stats_base;
+        print_json_response(out, &res, campus, opts->format);
+    } else {
+        print_json_error(out, "No path found");
+    }
+
+    // Cleanup local allocations
+    free_result(&res);
+    if(via_ids) free(via_ids);
+}
+
+// --- Dispatch ---
+
+// Parse one "--name=value" option, returns 0 if it is known and valid
+static int parse_option(QueryOptions* opts, const char* arg) {
+    if (strncmp(arg, "--algo=", 7) == 0) {
+        opts->search = find_search_algorithm(arg + 7);
+        return opts->search ? 0 : -1;
+    }
+    if (strncmp(arg, "--tsp-solver=", 13) == 0) {
+        const char* name = arg + 13;
+        if (strcmp(name, "auto") == 0) opts->tsp.solver = TSP_SOLVER_AUTO;
+        else if (strcmp(name, "exact") == 0) opts->tsp.solver = TSP_SOLVER_EXACT;
+        else if (strcmp(name, "heuristic") == 0) opts->tsp.solver = TSP_SOLVER_HEURISTIC;
+        else return -1;
+        return 0;
+    }
+    if (strncmp(arg, "--tsp-mode=", 11) == 0) {
+        const char* name = arg + 11;
+        if (strcmp(name, "open") == 0) opts->tsp.mode = TSP_MODE_OPEN;
+        else if (strcmp(name, "start") == 0) opts->tsp.mode = TSP_MODE_FIXED_START;
+        else if (strcmp(name, "start-end") == 0) opts->tsp.mode = TSP_MODE_FIXED_ENDS;
+        else if (strcmp(name, "round-trip") == 0) opts->tsp.mode = TSP_MODE_ROUND_TRIP;
+        else return -1;
+        return 0;
+    }
+    if (strncmp(arg, "--via-order=", 12) == 0) {
+        const char* name = arg + 12;
+        if (strcmp(name, "given") == 0) opts->reorder_via = 0;
+        else if (strcmp(name, "best") == 0) opts->reorder_via = 1;
+        else return -1;
+        return 0;
+    }
+    if (strncmp(arg, "--stats=", 8) == 0) {
+        const char* name = arg + 8;
+        if (strcmp(name, "on") == 0) opts->stats = 1;
+        else if (strcmp(name, "off") == 0) opts->stats = 0;
+        else return -1;
+        return 0;
+    }
+    if (strncmp(arg, "--format=", 9) == 0) {
+        return path_format_from_name(arg + 9, &opts->format);
+    }
+    if (strncmp(arg, "--limit=", 8) == 0) {
+        char* end;
+        long limit = strtol(arg + 8, &end, 10);
+        if (end == arg + 8 || *end != '\0' || limit <= 0) return -1;
+        opts->limit = limit > INT_MAX ? INT_MAX : (int)limit;
+        return 0;
+    }
+    if (strncmp(arg, "--tsp-budget=", 13) == 0) {
+        char* end;
+        double ms = strtod(arg + 13, &end);
+        if (end == arg + 13 || *end != '\0' || ms <= 0) return -1;
+        opts->tsp.time_budget = ms / 1000.0;
+        return 0;
+    }
+    return -1;
+}
+
+// Run one parsed query, the handlers write the JSON response to out
+static int run_query(FILE* out, Graph* campus, BuildingMapping* mapping,
+                     const QueryOptions* opts, int nargs, char** args) {
+    int status = 0;
+    if (strcmp(args[1], "--tsp") == 0) {
+        if (nargs < 4) {
+            print_json_error(out, "TSP mode requires at least 2 buildings");
+            status = 1;
+        } else {
+            handle_tsp_mode(out, campus, mapping, opts, nargs, args);
+        }
+    } else if (strcmp(args[1], "--from-coord") == 0) {
+        if (nargs != 5 || strcmp(args[3], "--to-coord") != 0) {
+            print_json_error(out, "Usage: --from-coord <lat,lon> --to-coord <lat,lon>");
+            status = 1;
+        } else {
+            handle_coord_mode(out, campus, mapping, opts, nargs, args);
+        }
+    } else if (strcmp(args[1], "--buildings") == 0) {
+        if (nargs > 3) {
+            print_json_error(out, "Usage: --buildings [prefix]");
+            status = 1;
+        } else {
+            handle_buildings_mode(out, mapping, opts, nargs, args);
+        }
+    } else if (strcmp(args[1], "--matrix") == 0) {
+        if (nargs < 3) {
+            print_json_error(out, "Matrix mode requires at least 1 building");
+            status = 1;
+        } else {
+            handle_matrix_mode(out, campus, mapping, opts, nargs, args);
+        }
+    } else {
+        if (nargs < 3) {
+            print_json_error(out, "Usage: <start> [via...] <end>");
+            status = 1;
+        } else {
+            handle_navigation_mode(out, campus, mapping, opts, nargs, args);
+        }
+    }
+    return status;
+}
+
+// --- Response Cache ---
+
+// Rendered responses of successful queries, NULL unless enabled (daemon)
+static LruCache* response_cache = NULL;
+
+void handlers_enable_cache(size_t response_bytes, size_t leg_bytes) {
+    handlers_disable_cache();
+    if (response_bytes > 0) response_cache = lru_create(response_bytes);
+    leg_cache_enable(leg_bytes);
+}
+
+void handlers_disable_cache(void) {
+    lru_free(response_cache);
+    response_cache = NULL;
+    leg_cache_disable();
+}
+
+// Normalized key: every option value (defaults included, so spelling and
+// order of the options do not matter) plus the length-prefixed positional arguments
+static char* query_key(const QueryOptions* opts, int nargs, char** args, size_t* key_len) {
+    char* key = NULL;
+    FILE* stream = open_memstream(&key, key_len);
+    // the search function pointer names the engine for the life of the process
+    fprintf(stream, "%p|%d|%d|%.17g|%d|%d|%d", (void*)opts->search, (int)opts->tsp.solver,
+            (int)opts->tsp.mode, opts->tsp.time_budget, opts->reorder_via, opts->limit,
+            (int)opts->format);
+    for (int i = 1; i < nargs; i++) fprintf(stream, "|%zu:%s", strlen(args[i]), args[i]);
+    fclose(stream);
+    return key;
+}
+
+static int is_success_response(const char* body, size_t len) {
+    static const char prefix[] = "{\n  \"status\": \"success\"";
+    return len >= sizeof(prefix) - 1 && memcmp(body, prefix, sizeof(prefix) - 1) == 0;
+}
+
+// --cache-stats : hit / miss counters of both caches
+static void handle_cache_stats(FILE* out) {
+    LruStats responses, legs;
+    int have_responses = response_cache != NULL;
+    if (have_responses) lru_stats(response_cache, &responses);
+    int have_legs = leg_cache_stats(&legs);
+    print_json_cache_stats(out, have_responses ? &responses : NULL, have_legs ? &legs : NULL);
+}
+
+// --stats-summary : instrumentation totals of every request so far
+static void handle_stats_summary(FILE* out) {
+    QueryStats totals;
+    unsigned long long requests;
+    stats_totals(&totals, &requests);
+    print_json_stats_summary(out, &totals, requests, stats_load_time());
+}
+
+int split_query_line(char* line, char* argv[], int max_args) {
+    int argc = 0;
+    argv[argc++] = "buzznav";
+
+    line[strcspn(line, "\r\n")] = '\0';
+    char* field = line;
+    while (argc < max_args) {
+        char* tab = strchr(field, '\t');
+        if (tab) *tab = '\0';
+        argv[argc++] = field;
+        if (!tab) break;
+        field = tab + 1;
+    }
+    return argc;
+}
+
+int dispatch_request(FILE* out, Graph* campus, BuildingMapping* mapping, int argc, char *argv[]) {
+    QueryOptions opts;
+    opts.search = astar;
+    opts.tsp.solver = TSP_SOLVER_AUTO;
+    opts.tsp.mode = TSP_MODE_OPEN;
+    opts.tsp.time_budget = TSP_HEURISTIC_DEFAULT_BUDGET;
+    opts.reorder_via = 0;
+    opts.limit = 0;
+    opts.format = PATH_FORMAT_COORDINATES;
+    opts.stats = 0;
+
+    // Split options from positional arguments
+    char** args = malloc(sizeof(char*) * (argc + 1));
+    int nargs = 0;
+    for (int i = 0; i < argc; i++) {
+        if (i > 0 && strncmp(argv[i], "--", 2) == 0 && strchr(argv[i], '=')) {
+            if (parse_option(&opts, argv[i]) != 0) {
+                print_json_error(out, "Unknown or invalid option");
+                free(args);
+                return 1;
+            }
+            continue;
+        }
+        args[nargs++] = argv[i];
+    }
+    args[nargs] = NULL;
+
+    int status = 0;
+    // every query counts towards --stats-summary, the two report modes do not
+    int instrumented = STATS_ENABLED && nargs >= 2 && strcmp(args[1], "--cache-stats") != 0 &&
+                       strcmp(args[1], "--stats-summary") != 0;
+    if (instrumented || opts.stats) stats_mark(&opts.stats_base);
+
+    if (nargs < 2) {
+        print_json_error(out, "Invalid arguments provided");
+        status = 1;
+    } else if ((opts.stats || strcmp(args[1], "--stats-summary") == 0) && !STATS_ENABLED) {
+        print_json_error(out, "Stats not compiled in (build with make STATS=1)");
+        status = 1;
+    } else if (strcmp(args[1], "--cache-stats") == 0) {
+        handle_cache_stats(out);
+    } else if (strcmp(args[1], "--stats-summary") == 0) {
+        handle_stats_summary(out);
+    } else if (!response_cache || opts.stats) {
+        // responses with stats describe this run, so they are never cached
+        status = run_query(out, campus, mapping, &opts, nargs, args);
+    } else {
+        // A hit skips search, instructions and JSON formatting
+        size_t key_len;
+        char* key = query_key(&opts, nargs, args, &key_len);
+        void* cached;
+        size_t cached_len;
+        if (lru_get(response_cache, key, key_len, &cached, &cached_len)) {
+            fwrite(cached, 1, cached_len, out);
+            free(cached);
+        } else {
+            char* body = NULL;
+            size_t body_len = 0;
+            FILE* stream = open_memstream(&body, &body_len);
+            status = run_query(stream, campus, mapping, &opts, nargs, args);
+            fclose(stream);
+            fwrite(body, 1, body_len, out);
+            if (status == 0 && is_success_response(body, body_len)) {
+                lru_put(response_cache, key, key_len, body, body_len);
+            }
+            free(body);
+        }
+        free(key);
+    }
+
+    if (instrumented) {
+        QueryStats request;
+        stats_since(&opts.stats_base, &request);
+        stats_aggregate(&request);
+    }
+
+    free(args);
+    return status;
+}
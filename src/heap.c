@@ -0,0 +1,233 @@
+#include <stdlib.h>
+#include <string.h>
+#include "heap.h"
+#include "stats.h"
+
+static HeapKind default_kind = HEAP_DEFAULT_KIND;
+
+HeapKind heap_default_kind(void) {
+    return default_kind;
+}
+
+void heap_set_default_kind(HeapKind kind) {
+    default_kind = kind;
+}
+
+int heap_kind_from_name(const char* name, HeapKind* kind) {
+    if (strcmp(name, "dary") == 0) *kind = HEAP_DARY;
+    else if (strcmp(name, "radix") == 0) *kind = HEAP_RADIX;
+    else return -1;
+    return 0;
+}
+
+void pq_init(PQueue* pq, int capacity, HeapKind kind) {
+    size_t n = (size_t)(capacity > 0 ? capacity : 1);
+    memset(pq, 0, sizeof(PQueue));
+    pq->kind = kind;
+    pq->capacity = capacity;
+    pq->pos = malloc(sizeof(int) * n);
+    for (size_t i = 0; i < n; i++) pq->pos[i] = -1;
+
+    if (kind == HEAP_DARY) {
+        pq->items = malloc(sizeof(HeapItem) * n);
+    } else {
+        pq->key = malloc(sizeof(double) * n);
+        pq->bits = malloc(sizeof(uint64_t) * n);
+        pq->bucket = malloc(n);
+    }
+}
+
+void pq_free(PQueue* pq) {
+    free(pq->pos);
+    free(pq->items);
+    free(pq->key);
+    free(pq->bits);
+    free(pq->bucket);
+    for (int b = 0; b < RADIX_BUCKETS; b++) free(pq->buckets[b].items);
+    memset(pq, 0, sizeof(PQueue));
+}
+
+void pq_clear(PQueue* pq) {
+    if (pq->kind == HEAP_DARY) {
+        for (int i = 0; i < pq->size; i++) pq->pos[pq->items[i].node_id] = -1;
+    } else {
+        for (int b = 0; b < RADIX_BUCKETS && pq->size > 0; b++) {
+            RadixBucket* bucket = &pq->buckets[b];
+            for (int i = 0; i < bucket->count; i++) pq->pos[bucket->items[i]] = -1;
+            pq->size -= bucket->count;
+            bucket->count = 0;
+        }
+        pq->last = 0;
+    }
+    pq->size = 0;
+}
+
+/******************************************************
+ * 4-ary heap
+ ******************************************************/
+
+static void dary_sift_up(PQueue* pq, int i, HeapItem item) {
+    while (i > 0) {
+        int parent = (i - 1) / 4;
+        if (pq->items[parent].key <= item.key) break;
+        pq->items[i] = pq->items[parent];
+        pq->pos[pq->items[i].node_id] = i;
+        i = parent;
+    }
+    pq->items[i] = item;
+    pq->pos[item.node_id] = i;
+}
+
+static void dary_sift_down(PQueue* pq, int i, HeapItem item) {
+    for (;;) {
+        int first = 4 * i + 1;
+        if (first >= pq->size) break;
+        int last = first + 4 < pq->size ? first + 4 : pq->size;
+        int best = first;
+        for (int c = first + 1; c < last; c++) {
+            if (pq->items[c].key < pq->items[best].key) best = c;
+        }
+        if (pq->items[best].key >= item.key) break;
+        pq->items[i] = pq->items[best];
+        pq->pos[pq->items[i].node_id] = i;
+        i = best;
+    }
+    pq->items[i] = item;
+    pq->pos[item.node_id] = i;
+}
+
+static int dary_push(PQueue* pq, int v, double key) {
+    int i = pq->pos[v];
+    if (i == -1) {
+        i = pq->size++;
+    } else if (key >= pq->items[i].key) {
+        return 0;
+    }
+    HeapItem item = {v, key};
+    dary_sift_up(pq, i, item);
+    return 1;
+}
+
+static int dary_pop(PQueue* pq, double* key) {
+    HeapItem top = pq->items[0];
+    pq->pos[top.node_id] = -1;
+    if (--pq->size > 0) dary_sift_down(pq, 0, pq->items[pq->size]);
+    if (key) *key = top.key;
+    return top.node_id;
+}
+
+/******************************************************
+ * Radix heap
+ ******************************************************/
+
+// Non-negative doubles compare like their bit patterns; flipping maps every
+// double to an unsigned integer of the same order
+static inline uint64_t key_to_bits(double key) {
+    uint64_t b;
+    memcpy(&b, &key, sizeof(b));
+    return (b >> 63) ? ~b : b | ((uint64_t)1 << 63);
+}
+
+static inline double bits_to_key(uint64_t b) {
+    b = (b >> 63) ? b & ~((uint64_t)1 << 63) : ~b;
+    double key;
+    memcpy(&key, &b, sizeof(key));
+    return key;
+}
+
+// Bucket 0 holds keys equal to last, bucket i keys whose highest bit differing from last is i - 1
+static inline int radix_bucket_of(uint64_t bits, uint64_t last) {
+    return bits == last ? 0 : 64 - __builtin_clzll(bits ^ last);
+}
+
+static void radix_insert(PQueue* pq, int v, int b) {
+    RadixBucket* bucket = &pq->buckets[b];
+    if (bucket->count == bucket->cap) {
+        bucket->cap = bucket->cap ? bucket->cap * 2 : 16;
+        bucket->items = realloc(bucket->items, sizeof(int) * bucket->cap);
+    }
+    pq->bucket[v] = (unsigned char)b;
+    pq->pos[v] = bucket->count;
+    bucket->items[bucket->count++] = v;
+}
+
+static void radix_remove(PQueue* pq, int v) {
+    RadixBucket* bucket = &pq->buckets[pq->bucket[v]];
+    int i = pq->pos[v];
+    int moved = bucket->items[--bucket->count];
+    bucket->items[i] = moved;
+    pq->pos[moved] = i;
+    pq->pos[v] = -1;
+}
+
+static int radix_push(PQueue* pq, int v, double key) {
+    uint64_t bits = key_to_bits(key);
+    if (bits < pq->last) {
+        bits = pq->last; // monotone clamp
+        key = bits_to_key(bits);
+    }
+
+    if (pq->pos[v] == -1) {
+        pq->size++;
+    } else {
+        if (bits >= pq->bits[v]) return 0;
+        radix_remove(pq, v);
+    }
+    pq->key[v] = key;
+    pq->bits[v] = bits;
+    radix_insert(pq, v, radix_bucket_of(bits, pq->last));
+    return 1;
+}
+
+// Refill bucket 0: advance last to the smallest key and spread its bucket downwards
+static void radix_pull(PQueue* pq) {
+    int b = 1;
+    while (pq->buckets[b].count == 0) b++;
+
+    RadixBucket* bucket = &pq->buckets[b];
+    uint64_t min_bits = pq->bits[bucket->items[0]];
+    for (int i = 1; i < bucket->count; i++) {
+        uint64_t bits = pq->bits[bucket->items[i]];
+        if (bits < min_bits) min_bits = bits;
+    }
+    pq->last = min_bits;
+
+    // every key of bucket b now lands in a lower bucket, so none is revisited
+    int count = bucket->count;
+    bucket->count = 0;
+    for (int i = 0; i < count; i++) {
+        int v = bucket->items[i];
+        radix_insert(pq, v, radix_bucket_of(pq->bits[v], min_bits));
+    }
+}
+
+static int radix_pop(PQueue* pq, double* key) {
+    if (pq->buckets[0].count == 0) radix_pull(pq);
+    RadixBucket* bucket = &pq->buckets[0];
+    int v = bucket->items[--bucket->count];
+    pq->pos[v] = -1;
+    pq->size--;
+    if (key) *key = pq->key[v];
+    return v;
+}
+
+/******************************************************
+ * Dispatch
+ ******************************************************/
+
+int pq_push(PQueue* pq, int v, double key) {
+    STAT_ADD(STAT_HEAP_PUSHES, 1);
+    return pq->kind == HEAP_DARY ? dary_push(pq, v, key) : radix_push(pq, v, key);
+}
+
+int pq_pop(PQueue* pq, double* key) {
+    STAT_ADD(STAT_HEAP_POPS, 1);
+    return pq->kind == HEAP_DARY ? dary_pop(pq, key) : radix_pop(pq, key);
+}
+
+double pq_min_key(PQueue* pq) {
+    if (pq->size == 0) return DBL_MAX;
+    if (pq->kind == HEAP_DARY) return pq->items[0].key;
+    if (pq->buckets[0].count == 0) radix_pull(pq);
+    return pq->key[pq->buckets[0].items[0]];
+}
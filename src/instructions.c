@@ -1,8 +1,11 @@
 #include "instructions.h"
 #include "utils.h"
+#include "spatial.h"
+#include "stats.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <float.h>
 #include <math.h>
 
 #ifndef M_PI
@@ -75,30 +78,35 @@ const char* get_turn_instruction(double turn_angle) {
 // Helper function to get building name from node ID
 const char* get_building_name_from_node(BuildingMapping* mapping, int node_id) {
     if (!mapping) return NULL;
-    
-    for (int i = 0; i < mapping->count; i++) {
-        if (mapping->entries[i].node_id == node_id) {
-            return mapping->entries[i].name;
-        }
-    }
-    return NULL;
+
+    int entry = get_building_at_node(mapping, node_id);
+    return entry >= 0 ? mapping->entries[entry].name : NULL;
 }
 
 // Helper function to find nearest building to a node
 const char* get_nearest_building_description(Graph* graph, BuildingMapping* mapping, int node_id, double* distance_out) {
     if (!mapping || !graph) return NULL;
-    
+
+    if (mapping->grid) {
+        double dist;
+        int entry = spatial_nearest(mapping->grid, graph->lat[node_id], graph->lon[node_id], DBL_MAX, &dist);
+        if (entry < 0) return NULL;
+        if (distance_out) *distance_out = dist;
+        return mapping->entries[entry].name;
+    }
+
+    // no grid attached: scan every building
     double min_dist = 999999.0;
     const char* nearest_building = NULL;
     
-    double node_lat = graph->nodes[node_id].lat;
-    double node_lon = graph->nodes[node_id].lon;
+    double node_lat = graph->lat[node_id];
+    double node_lon = graph->lon[node_id];
     
     for (int i = 0; i < mapping->count; i++) {
         int building_node = mapping->entries[i].node_id;
         double dist = haversine(
             node_lat, node_lon,
-            graph->nodes[building_node].lat, graph->nodes[building_node].lon
+            graph->lat[building_node], graph->lon[building_node]
         );
         
         if (dist < min_dist) {
@@ -126,10 +134,12 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
     
     // Allocate instruction array (max possible instructions)
     char** instructions = malloc(sizeof(char*) * (path_len + 2));
+    STAT_ADD(STAT_ALLOC_BYTES, sizeof(char*) * (path_len + 2));
     int count = 0;
     
     // Start instruction
     instructions[count] = malloc(256);
+    STAT_ADD(STAT_ALLOC_BYTES, 256);
     sprintf(instructions[count], "Start at %s", start_name);
     count++;
     
@@ -138,20 +148,21 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
         int node1 = path[0];
         int node2 = path[1];
         double bearing = calculate_bearing(
-            graph->nodes[node1].lat, graph->nodes[node1].lon,
-            graph->nodes[node2].lat, graph->nodes[node2].lon
+            graph->lat[node1], graph->lon[node1],
+            graph->lat[node2], graph->lon[node2]
         );
         const char* dir = get_direction_name(bearing);
         
         // Calculate initial segment distance
         double segment_dist = haversine(
-            graph->nodes[node1].lat, graph->nodes[node1].lon,
-            graph->nodes[node2].lat, graph->nodes[node2].lon
+            graph->lat[node1], graph->lon[node1],
+            graph->lat[node2], graph->lon[node2]
         );
         
         // Only add direction instruction if distance is significant
         if (segment_dist >= 5.0) {
             instructions[count] = malloc(256);
+            STAT_ADD(STAT_ALLOC_BYTES, 256);
             sprintf(instructions[count], "Head %s for %.1f meters", dir, segment_dist);
             count++;
         }
@@ -161,8 +172,8 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
     double prev_bearing = 0.0;
     if (path_len >= 2) {
         prev_bearing = calculate_bearing(
-            graph->nodes[path[0]].lat, graph->nodes[path[0]].lon,
-            graph->nodes[path[1]].lat, graph->nodes[path[1]].lon
+            graph->lat[path[0]], graph->lon[path[0]],
+            graph->lat[path[1]], graph->lon[path[1]]
         );
     }
     
@@ -174,8 +185,8 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
         
         // Calculate bearing to next node
         double curr_bearing = calculate_bearing(
-            graph->nodes[curr_node].lat, graph->nodes[curr_node].lon,
-            graph->nodes[next_node].lat, graph->nodes[next_node].lon
+            graph->lat[curr_node], graph->lon[curr_node],
+            graph->lat[next_node], graph->lon[next_node]
         );
         
         // Calculate turn angle
@@ -183,14 +194,15 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
         
         // Calculate segment distance
         double segment_dist = haversine(
-            graph->nodes[curr_node].lat, graph->nodes[curr_node].lon,
-            graph->nodes[next_node].lat, graph->nodes[next_node].lon
+            graph->lat[curr_node], graph->lon[curr_node],
+            graph->lat[next_node], graph->lon[next_node]
         );
         
         // If significant turn (> 20 degrees), create turn instruction
         if (fabs(turn_angle) > 20.0) {
             const char* turn_text = get_turn_instruction(turn_angle);
             instructions[count] = malloc(300);
+            STAT_ADD(STAT_ALLOC_BYTES, 300);
             
             // Try to get building name for this node
             const char* building_name = get_building_name_from_node(mapping, curr_node);
@@ -216,6 +228,7 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
             if (segment_dist >= 10.0) {
                 const char* dir = get_direction_name(curr_bearing);
                 instructions[count] = malloc(256);
+                STAT_ADD(STAT_ALLOC_BYTES, 256);
                 sprintf(instructions[count], "Continue %s for %.1f meters", dir, segment_dist);
                 count++;
             }
@@ -231,6 +244,7 @@ char** generate_instructions(Graph* graph, int* path, int path_len,
     
     // Final instruction
     instructions[count] = malloc(256);
+    STAT_ADD(STAT_ALLOC_BYTES, 256);
     sprintf(instructions[count], "You have reached %s", end_name);
     count++;
     
@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include "json.h"
+#include "stats.h"
+
+/*
+* numbers: values are scaled by 10^decimals, rounded once and printed digit
+* by digit; near ties and values of 1e15 or more after scaling fall back to
+* snprintf so the output always matches printf
+* strings: quote, backslash and control characters escaped, the rest copied
+* paths: polyline (varint deltas, text) or delta32 (int32 deltas, base64),
+* both much smaller than the coordinate array and cheap to decode
+*/
+
+#define FIXED_MAX_DECIMALS 9
+#define FIXED_FALLBACK_LEN 352 // "%.9f" of DBL_MAX
+
+static const double pow10_table[FIXED_MAX_DECIMALS + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9
+};
+
+// One buffer per thread, reused by every response the thread writes
+static JsonBuf thread_buffer = {NULL, 0, 0};
+#pragma omp threadprivate(thread_buffer)
+
+JsonBuf* json_thread_buffer(void) {
+    thread_buffer.len = 0;
+    return &thread_buffer;
+}
+
+void json_buf_reserve(JsonBuf* b, size_t n) {
+    if (b->len + n <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 4096;
+    while (cap < b->len + n) cap *= 2;
+    b->data = realloc(b->data, cap);
+    STAT_ADD(STAT_ALLOC_BYTES, cap - b->cap);
+    b->cap = cap;
+}
+
+void json_buf_append(JsonBuf* b, const char* s, size_t n) {
+    json_buf_reserve(b, n);
+    memcpy(b->data + b->len, s, n);
+    b->len += n;
+}
+
+void json_buf_string(JsonBuf* b, const char* s) {
+    static const char hex[] = "0123456789abcdef";
+    json_buf_char(b, '"');
+    for (const unsigned char* p = (const unsigned char*)s; *p; p++) {
+        unsigned char c = *p;
+        if (c == '"' || c == '\\') {
+            json_buf_char(b, '\\');
+            json_buf_char(b, (char)c);
+        } else if (c == '\n') {
+            json_buf_literal(b, "\\n");
+        } else if (c == '\t') {
+            json_buf_literal(b, "\\t");
+        } else if (c == '\r') {
+            json_buf_literal(b, "\\r");
+        } else if (c < 0x20) {
+            char esc[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            json_buf_append(b, esc, sizeof(esc));
+        } else {
+            json_buf_char(b, (char)c);
+        }
+    }
+    json_buf_char(b, '"');
+}
+
+// Digits of v, most significant first, into the end of a scratch buffer
+static char* format_unsigned(unsigned long long v, char* end) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return end;
+}
+
+void json_buf_int(JsonBuf* b, long long v) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    unsigned long long mag = v < 0 ? 0ULL - (unsigned long long)v : (unsigned long long)v;
+    char* start = format_unsigned(mag, end);
+    if (v < 0) *--start = '-';
+    json_buf_append(b, start, (size_t)(end - start));
+}
+
+void json_buf_fixed(JsonBuf* b, double v, int decimals) {
+    if (decimals < 0) decimals = 0;
+    if (decimals > FIXED_MAX_DECIMALS) decimals = FIXED_MAX_DECIMALS;
+
+    double mag = fabs(v);
+    double scaled = mag * pow10_table[decimals];
+    // the product is off by at most half an ulp, which only matters near a tie;
+    // those (decided on the exact binary value by printf) and huge values go to snprintf
+    double frac = scaled - floor(scaled);
+    int near_tie = fabs(frac - 0.5) <= 1e-9 + scaled * 2.3e-16;
+    if (!isfinite(v) || scaled >= 1e15 || near_tie) {
+        char tmp[FIXED_FALLBACK_LEN];
+        int n = snprintf(tmp, sizeof(tmp), "%.*f", decimals, v);
+        if (n >= (int)sizeof(tmp)) n = (int)sizeof(tmp) - 1;
+        json_buf_append(b, tmp, (size_t)n);
+        return;
+    }
+
+    unsigned long long r = (unsigned long long)(scaled + 0.5);
+    unsigned long long p = (unsigned long long)pow10_table[decimals];
+    unsigned long long whole = r / p;
+    unsigned long long part = r % p;
+
+    char digits[48];
+    char* end = digits + sizeof(digits);
+    char* start = end;
+    if (decimals > 0) {
+        for (int i = 0; i < decimals; i++) {
+            *--start = (char)('0' + part % 10);
+            part /= 10;
+        }
+        *--start = '.';
+    }
+    start = format_unsigned(whole, start);
+    if (signbit(v)) *--start = '-';
+    json_buf_append(b, start, (size_t)(end - start));
+}
+
+/******************************************************
+ * Path encodings
+ ******************************************************/
+
+static void polyline_value(JsonBuf* b, long long delta) {
+    unsigned long long v = delta < 0 ? ~((unsigned long long)delta << 1) : (unsigned long long)delta << 1;
+    while (v >= 0x20) {
+        char c = (char)((0x20 | (v & 0x1f)) + 63);
+        if (c == '\\') json_buf_char(b, '\\');
+        json_buf_char(b, c);
+        v >>= 5;
+    }
+    char c = (char)(v + 63);
+    if (c == '\\') json_buf_char(b, '\\');
+    json_buf_char(b, c);
+}
+
+void json_buf_polyline(JsonBuf* b, const double* lat, const double* lon, int n, int precision) {
+    double factor = precision >= 6 ? 1e6 : 1e5;
+    // at most 2 x 6 characters per point at precision 6 (plus the odd escaped backslash)
+    json_buf_reserve(b, (size_t)n * 16 + 2);
+    json_buf_char(b, '"');
+    long long prev_lat = 0, prev_lon = 0;
+    for (int i = 0; i < n; i++) {
+        long long y = llround(lat[i] * factor);
+        long long x = llround(lon[i] * factor);
+        polyline_value(b, y - prev_lat);
+        polyline_value(b, x - prev_lon);
+        prev_lat = y;
+        prev_lon = x;
+    }
+    json_buf_char(b, '"');
+}
+
+// Base64 of three bytes (or fewer at the end, padded with '=')
+static void base64_group(JsonBuf* b, const unsigned char* in, int len) {
+    static const char alphabet[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    unsigned v = (unsigned)in[0] << 16;
+    if (len > 1) v |= (unsigned)in[1] << 8;
+    if (len > 2) v |= in[2];
+    char out[4] = {
+        alphabet[(v >> 18) & 63], alphabet[(v >> 12) & 63],
+        len > 1 ? alphabet[(v >> 6) & 63] : '=', len > 2 ? alphabet[v & 63] : '='
+    };
+    json_buf_append(b, out, sizeof(out));
+}
+
+void json_buf_delta32(JsonBuf* b, const double* lat, const double* lon, int n) {
+    size_t num_bytes = (size_t)n * 8;
+    unsigned char* raw = malloc(num_bytes ? num_bytes : 1);
+    long long prev_lat = 0, prev_lon = 0;
+    for (int i = 0; i < n; i++) {
+        long long y = llround(lat[i] * 1e6);
+        long long x = llround(lon[i] * 1e6);
+        uint32_t values[2] = {(uint32_t)(int32_t)(y - prev_lat), (uint32_t)(int32_t)(x - prev_lon)};
+        for (int k = 0; k < 2; k++) {
+            unsigned char* p = raw + (size_t)i * 8 + k * 4;
+            p[0] = (unsigned char)(values[k] & 0xff);
+            p[1] = (unsigned char)((values[k] >> 8) & 0xff);
+            p[2] = (unsigned char)((values[k] >> 16) & 0xff);
+            p[3] = (unsigned char)(values[k] >> 24);
+        }
+        prev_lat = y;
+        prev_lon = x;
+    }
+
+    json_buf_reserve(b, (num_bytes + 2) / 3 * 4 + 2);
+    json_buf_char(b, '"');
+    for (size_t i = 0; i < num_bytes; i += 3) {
+        size_t left = num_bytes - i;
+        base64_group(b, raw + i, left < 3 ? (int)left : 3);
+    }
+    json_buf_char(b, '"');
+    free(raw);
+}
+
+int json_buf_write(const JsonBuf* b, FILE* out) {
+    int fd = fileno(out);
+    if (fd < 0) {
+        return fwrite(b->data, 1, b->len, out) == b->len ? 0 : -1;
+    }
+
+    // keep ordering with anything already buffered in the stream
+    if (fflush(out) != 0) return -1;
+    const char* data = b->data;
+    size_t len = b->len;
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "graph.h"
+#include "utils.h"
+#include "astar.h"
+#include "search_context.h"
+#include "landmarks.h"
+
+/*
+* landmark selection: farthest point
+*   the first landmark is the node farthest from node 0, every next one the
+*   node farthest from all landmarks chosen so far
+* query: A* with h(v) = max(haversine, max over landmarks of the two bounds)
+*/
+
+// Tables are floats: allow for their rounding so the bound stays admissible
+#define FLOAT_SLACK 1.2e-7
+
+/******************************************************
+ * Landmark tables
+ ******************************************************/
+
+// One-to-all Dijkstra over out-edges (reverse = 0) or in-edges (reverse = 1)
+static void dijkstra_all(const Graph* g, int src, int reverse, double* dist) {
+    const int* offsets = reverse ? g->rev_offsets : g->offsets;
+    const int* adjacent = reverse ? g->rev_sources : g->targets;
+    const double* weights = reverse ? g->rev_weights : g->weights;
+
+    for (int i = 0; i < g->num_nodes; i++) dist[i] = DBL_MAX;
+    dist[src] = 0.0;
+
+    PQueue heap;
+    pq_init(&heap, g->num_nodes, heap_default_kind());
+    pq_push(&heap, src, 0.0);
+    while (!pq_empty(&heap)) {
+        double du;
+        int u = pq_pop(&heap, &du);
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            int v = adjacent[e];
+            double nd = du + weights[e];
+            if (nd < dist[v]) {
+                dist[v] = nd;
+                pq_push(&heap, v, nd);
+            }
+        }
+    }
+    pq_free(&heap);
+}
+
+// Fill the from/to columns of landmark l
+static void compute_tables(Landmarks* lm, const Graph* g, int l, double* dist) {
+    int n = g->num_nodes;
+    dijkstra_all(g, lm->nodes[l], 0, dist);
+    for (int v = 0; v < n; v++) {
+        lm->from[(size_t)v * lm->count + l] = dist[v] == DBL_MAX ? INFINITY : (float)dist[v];
+    }
+    dijkstra_all(g, lm->nodes[l], 1, dist);
+    for (int v = 0; v < n; v++) {
+        lm->to[(size_t)v * lm->count + l] = dist[v] == DBL_MAX ? INFINITY : (float)dist[v];
+    }
+}
+
+Landmarks* landmarks_build(const Graph* g, int count) {
+    int n = g->num_nodes;
+    if (count > n) count = n;
+
+    Landmarks* lm = malloc(sizeof(Landmarks));
+    lm->count = count;
+    lm->num_nodes = n;
+    lm->nodes = malloc(sizeof(int) * (count > 0 ? count : 1));
+    lm->from = malloc(sizeof(float) * ((size_t)n * count + 1));
+    lm->to = malloc(sizeof(float) * ((size_t)n * count + 1));
+
+    double* dist = malloc(sizeof(double) * n);
+    double* closest = malloc(sizeof(double) * n); // distance to the nearest chosen landmark
+
+    // seed: the node farthest from node 0
+    dijkstra_all(g, 0, 0, dist);
+    for (int v = 0; v < n; v++) closest[v] = dist[v];
+
+    int chosen = 0;
+    while (chosen < count) {
+        int next = -1;
+        for (int v = 0; v < n; v++) {
+            if (closest[v] == DBL_MAX) continue; // not connected to what we have seen
+            if (next == -1 || closest[v] > closest[next]) next = v;
+        }
+        if (next == -1 || (chosen > 0 && closest[next] <= 0.0)) break;
+
+        lm->nodes[chosen++] = next;
+
+        // distances in either direction count as "close"
+        dijkstra_all(g, next, 0, dist);
+        for (int v = 0; v < n; v++) {
+            if (dist[v] < closest[v] || chosen == 1) closest[v] = dist[v];
+        }
+        dijkstra_all(g, next, 1, dist);
+        for (int v = 0; v < n; v++) {
+            if (dist[v] < closest[v]) closest[v] = dist[v];
+        }
+    }
+    lm->count = chosen;
+
+    free(dist);
+    free(closest);
+
+    landmarks_update(lm, g);
+    return lm;
+}
+
+void landmarks_update(Landmarks* lm, const Graph* g) {
+    #pragma omp parallel for schedule(dynamic)
+    for (int l = 0; l < lm->count; l++) {
+        double* dist = malloc(sizeof(double) * g->num_nodes);
+        compute_tables(lm, g, l, dist);
+        free(dist);
+    }
+}
+
+void landmarks_free(Landmarks* lm) {
+    if (!lm) return;
+    free(lm->nodes);
+    free(lm->from);
+    free(lm->to);
+    free(lm);
+}
+
+/******************************************************
+ * ALT query
+ ******************************************************/
+
+// Largest landmark lower bound on d(v, t), INFINITY if t is provably unreachable
+static double landmark_bound(const Landmarks* lm, int v, int t) {
+    int k = lm->count;
+    const float* from_v = lm->from + (size_t)v * k;
+    const float* from_t = lm->from + (size_t)t * k;
+    const float* to_v = lm->to + (size_t)v * k;
+    const float* to_t = lm->to + (size_t)t * k;
+
+    double best = 0.0;
+    for (int l = 0; l < k; l++) {
+        // d(L, t) - d(L, v)
+        if (isinf(from_t[l])) {
+            if (!isinf(from_v[l])) return INFINITY; // L reaches v but not t
+        } else if (!isinf(from_v[l])) {
+            double bound = (double)from_t[l] - from_v[l] - ((double)from_t[l] + from_v[l]) * FLOAT_SLACK;
+            if (bound > best) best = bound;
+        }
+        // d(v, L) - d(t, L)
+        if (isinf(to_v[l])) {
+            if (!isinf(to_t[l])) return INFINITY; // t reaches L but v does not
+        } else if (!isinf(to_t[l])) {
+            double bound = (double)to_v[l] - to_t[l] - ((double)to_v[l] + to_t[l]) * FLOAT_SLACK;
+            if (bound > best) best = bound;
+        }
+    }
+    return best;
+}
+
+// graph->landmarks, built by the first ALT query; later queries only pay an atomic load
+static const Landmarks* graph_landmarks(Graph* graph) {
+    Landmarks* lm = __atomic_load_n(&graph->landmarks, __ATOMIC_ACQUIRE);
+    if (lm) return lm;
+    #pragma omp critical(landmarks_build)
+    {
+        lm = graph->landmarks;
+        if (!lm) {
+            lm = landmarks_build(graph, ALT_DEFAULT_LANDMARKS);
+            __atomic_store_n(&graph->landmarks, lm, __ATOMIC_RELEASE);
+        }
+    }
+    return lm;
+}
+
+double astar_alt(Graph* graph, int start_id, int goal_id, int** out_path, int* out_len) {
+    const Landmarks* lm = graph_landmarks(graph);
+    if (!lm) return astar(graph, start_id, goal_id, out_path, out_len);
+
+    // ctx->value caches h(v)
+    SearchContext* ctx = search_context_acquire(graph);
+    search_context_begin(ctx);
+    PQueue* open_set = &ctx->side[0].heap;
+
+    double goal_lat = graph->lat[goal_id], goal_lon = graph->lon[goal_id];
+
+    sc_set(ctx, 0, start_id, 0.0, -1, -1);
+    sc_set_value(ctx, start_id, 0.0);
+    pq_push(open_set, start_id, 0.0);
+
+    // nodes may be reopened: the float slack makes the bound admissible but not exactly consistent
+    while (!pq_empty(open_set)) {
+        int current = pq_pop(open_set, NULL);
+        sc_settled(ctx);
+        if (current == goal_id) break;
+        double current_g = sc_dist(ctx, 0, current);
+
+        STAT_ADD(STAT_EDGES_RELAXED, graph->offsets[current + 1] - graph->offsets[current]);
+        for (int e = graph->offsets[current]; e < graph->offsets[current + 1]; e++) {
+            int neighbor = graph->targets[e];
+            double tentative_g = current_g + graph->weights[e];
+            if (tentative_g >= sc_dist(ctx, 0, neighbor)) continue;
+
+            if (!sc_has_value(ctx, neighbor)) {
+                double h = haversine(graph->lat[neighbor], graph->lon[neighbor], goal_lat, goal_lon);
+                double bound = landmark_bound(lm, neighbor, goal_id);
+                sc_set_value(ctx, neighbor, bound > h ? bound : h);
+            }
+            if (isinf(ctx->value[neighbor])) continue; // goal unreachable from neighbor
+
+            sc_set(ctx, 0, neighbor, tentative_g, current, e);
+            pq_push(open_set, neighbor, tentative_g + ctx->value[neighbor]);
+        }
+    }
+
+    double total_dist = sc_dist(ctx, 0, goal_id);
+    if (total_dist == DBL_MAX) {
+        *out_path = NULL;
+        *out_len = 0;
+    } else {
+        *out_path = sc_build_path(ctx, 0, goal_id, out_len);
+    }
+    return total_dist;
+}
@@ -0,0 +1,227 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <time.h>
+#include <pthread.h>
+#include "json.h"
+#include "logging.h"
+
+/*
+* Each ring has a single producer (the thread that owns it) and a single
+* consumer (the drain thread):
+*   head: next slot to write, advanced by the producer (release)
+*   tail: next slot to read, advanced by the consumer (release)
+* head - tail == LOG_RING_SLOTS means full, the producer then drops the record.
+* Rings are pushed onto a lock-free list and never freed;
+* the ring of an exited thread is handed to the next new thread.
+*/
+
+typedef struct {
+    double ts;
+    LogLevel level;
+    char message[LOG_MESSAGE_MAX];
+} LogRecord;
+
+typedef struct LogRing {
+    unsigned head;
+    unsigned tail;
+    unsigned long dropped;          // written by the producer only
+    unsigned long dropped_reported; // drain thread only
+    int owned;                      // 1 while a live thread writes to it
+    int id;
+    struct LogRing* next;
+    LogRecord records[LOG_RING_SLOTS];
+} LogRing;
+
+LogLevel log_runtime_level = LOG_LEVEL_INFO;
+
+static LogRing* rings = NULL;
+static int num_rings = 0;
+static LogRing* thread_ring = NULL;
+#pragma omp threadprivate(thread_ring)
+
+static FILE* sink = NULL;
+static int sink_owned = 0; // opened by log_init, closed on shutdown
+static pthread_t drain_thread;
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static int running = 0;
+
+// Drain interval when every ring is empty
+#define LOG_DRAIN_SLEEP_NS 5000000L
+
+static const char* const level_names[] = {"debug", "info", "warn", "error", "off"};
+
+int log_level_from_name(const char* name, LogLevel* out) {
+    for (int l = LOG_LEVEL_DEBUG; l <= LOG_LEVEL_OFF; l++) {
+        if (strcmp(name, level_names[l]) == 0) {
+            *out = (LogLevel)l;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static double wall_clock(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/******************************************************
+ * Producer side
+ ******************************************************/
+
+// Thread exit: the next thread that logs may take the ring over
+static void release_ring(void* ring) {
+    __atomic_store_n(&((LogRing*)ring)->owned, 0, __ATOMIC_RELEASE);
+}
+
+static void create_ring_key(void) {
+    pthread_key_create(&ring_key, release_ring);
+}
+
+static LogRing* attach_ring(void) {
+    for (LogRing* r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&r->owned, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            thread_ring = r;
+            pthread_setspecific(ring_key, r);
+            return r;
+        }
+    }
+
+    LogRing* r = calloc(1, sizeof(LogRing));
+    if (!r) return NULL;
+    r->owned = 1;
+    r->id = __atomic_fetch_add(&num_rings, 1, __ATOMIC_RELAXED);
+    r->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    thread_ring = r;
+    pthread_setspecific(ring_key, r);
+    return r;
+}
+
+void log_write(LogLevel level, const char* fmt, ...) {
+    va_list args;
+
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        // no drain thread: print right away
+        char message[LOG_MESSAGE_MAX];
+        va_start(args, fmt);
+        vsnprintf(message, sizeof(message), fmt, args);
+        va_end(args);
+        fprintf(stderr, "[%s] %s\n", level_names[level], message);
+        return;
+    }
+
+    LogRing* ring = thread_ring ? thread_ring : attach_ring();
+    if (!ring) return;
+
+    unsigned head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) >= LOG_RING_SLOTS) {
+        __atomic_store_n(&ring->dropped, ring->dropped + 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    LogRecord* record = &ring->records[head % LOG_RING_SLOTS];
+    record->ts = wall_clock();
+    record->level = level;
+    va_start(args, fmt);
+    vsnprintf(record->message, sizeof(record->message), fmt, args);
+    va_end(args);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+}
+
+/******************************************************
+ * Drain thread
+ ******************************************************/
+
+static void json_record(JsonBuf* b, double ts, LogLevel level, int thread, const char* message) {
+    json_buf_literal(b, "{\"ts\": ");
+    json_buf_fixed(b, ts, 6);
+    json_buf_literal(b, ", \"level\": ");
+    json_buf_string(b, level_names[level]);
+    json_buf_literal(b, ", \"thread\": ");
+    json_buf_int(b, thread);
+    json_buf_literal(b, ", \"msg\": ");
+    json_buf_string(b, message);
+    json_buf_literal(b, "}\n");
+}
+
+// Move every pending record to the sink, returns how many were written
+static int drain_rings(void) {
+    JsonBuf* b = json_thread_buffer();
+    int written = 0;
+    for (LogRing* r = __atomic_load_n(&rings, __ATOMIC_ACQUIRE); r; r = r->next) {
+        unsigned tail = r->tail;
+        unsigned head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        for (; tail != head; tail++) {
+            const LogRecord* record = &r->records[tail % LOG_RING_SLOTS];
+            json_record(b, record->ts, record->level, r->id, record->message);
+            written++;
+        }
+        __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+        unsigned long dropped = __atomic_load_n(&r->dropped, __ATOMIC_RELAXED);
+        if (dropped != r->dropped_reported) {
+            char message[64];
+            snprintf(message, sizeof(message), "log ring full, dropped %lu records",
+                     dropped - r->dropped_reported);
+            json_record(b, wall_clock(), LOG_LEVEL_WARN, r->id, message);
+            r->dropped_reported = dropped;
+            written++;
+        }
+    }
+    if (b->len > 0) json_buf_write(b, sink);
+    return written;
+}
+
+static void* drain_main(void* arg) {
+    (void)arg;
+    struct timespec pause = {0, LOG_DRAIN_SLEEP_NS};
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        if (drain_rings() == 0) nanosleep(&pause, NULL);
+    }
+    return NULL;
+}
+
+int log_init(const char* path, LogLevel level) {
+    if (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return 0;
+
+    sink = stderr;
+    sink_owned = 0;
+    if (path) {
+        sink = fopen(path, "a");
+        if (!sink) {
+            fprintf(stderr, "\033[31m:( Failed opening log file '%s'\033[0m\n", path);
+            sink = stderr;
+            return -1;
+        }
+        sink_owned = 1;
+    }
+
+    pthread_once(&ring_key_once, create_ring_key);
+    log_runtime_level = level;
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    if (pthread_create(&drain_thread, NULL, drain_main, NULL) != 0) {
+        __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    return 0;
+}
+
+void log_shutdown(void) {
+    if (!__atomic_load_n(&running, __ATOMIC_ACQUIRE)) return;
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    pthread_join(drain_thread, NULL);
+    drain_rings();
+
+    // rings stay allocated: pooled threads keep pointing at theirs, and
+    // records print directly until the next log_init
+    if (sink_owned) fclose(sink);
+    sink = NULL;
+    sink_owned = 0;
+}
@@ -0,0 +1,209 @@
+#include <stdlib.h>
+#include <float.h>
+#include "graph.h"
+#include "ch.h"
+#include "search_context.h"
+#include "matrix.h"
+
+/******************************************************
+ * One-to-many Dijkstra (no hierarchy)
+ ******************************************************/
+
+// Settle nodes from src until every target is settled or the queue passes max_dist
+// Targets are marked in the context's value slots, so marking is undone by the next begin
+static int dijkstra_to_targets(const Graph* g, SearchContext* ctx, int src,
+                               const int* targets, int num_targets, double max_dist,
+                               double* out_dist) {
+    search_context_begin(ctx);
+    PQueue* pq = &ctx->side[0].heap;
+
+    int remaining = 0;
+    for (int j = 0; j < num_targets; j++) {
+        if (!sc_has_value(ctx, targets[j])) {
+            sc_set_value(ctx, targets[j], 1.0);
+            remaining++;
+        }
+    }
+
+    sc_set(ctx, 0, src, 0.0, -1, -1);
+    pq_push(pq, src, 0.0);
+
+    while (remaining > 0 && !pq_empty(pq)) {
+        double du;
+        int u = pq_pop(pq, &du);
+        if (du > max_dist) break;
+        sc_settled(ctx);
+        if (sc_has_value(ctx, u) && --remaining == 0) break;
+
+        STAT_ADD(STAT_EDGES_RELAXED, g->offsets[u + 1] - g->offsets[u]);
+        for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+            int v = g->targets[e];
+            double nd = du + g->weights[e];
+            if (nd < sc_dist(ctx, 0, v)) {
+                sc_set(ctx, 0, v, nd, u, e);
+                pq_push(pq, v, nd);
+            }
+        }
+    }
+
+    // settled labels are final; anything left unsettled lies beyond max_dist
+    int reached = 0;
+    for (int j = 0; j < num_targets; j++) {
+        double d = sc_dist(ctx, 0, targets[j]);
+        out_dist[j] = d <= max_dist ? d : DBL_MAX;
+        if (out_dist[j] != DBL_MAX) reached++;
+    }
+    return reached;
+}
+
+int dijkstra_one_to_many(Graph* graph, int source, const int* targets, int num_targets,
+                         double max_dist, double* out_dist) {
+    SearchContext* ctx = search_context_acquire(graph);
+    return dijkstra_to_targets(graph, ctx, source, targets, num_targets, max_dist, out_dist);
+}
+
+void dijkstra_one_to_many_batch(Graph* graph, const int* sources, int num_sources,
+                                const int* targets, int num_targets, double max_dist,
+                                double* out_dist) {
+    STATS_CALLER(caller);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_sources; i++) {
+        STATS_CREDIT_BEGIN(credit, caller);
+        SearchContext* ctx = search_context_acquire(graph);
+        dijkstra_to_targets(graph, ctx, sources[i], targets, num_targets, max_dist,
+                            out_dist + (size_t)i * num_targets);
+        STATS_CREDIT_END(credit);
+    }
+}
+
+/******************************************************
+ * Bucket-based many-to-many on the hierarchy
+ ******************************************************/
+
+// Nodes settled by one upward search, with their distances
+typedef struct {
+    int* nodes;
+    double* dist;
+    int count;
+    int cap;
+} SearchSpace;
+
+typedef struct {
+    int target; // column index
+    double dist;
+} BucketEntry;
+
+// Full upward search from root: side 0 over up edges, side 1 over down edges (backwards)
+static void upward_search(const CHGraph* ch, SearchContext* ctx, int side, int root, SearchSpace* space) {
+    const int* offsets = side == 0 ? ch->up_offsets : ch->down_offsets;
+    const int* adjacent = side == 0 ? ch->up_targets : ch->down_sources;
+    const double* weights = side == 0 ? ch->up_weights : ch->down_weights;
+
+    search_context_begin(ctx);
+    PQueue* pq = &ctx->side[side].heap;
+    sc_set(ctx, side, root, 0.0, -1, -1);
+    pq_push(pq, root, 0.0);
+
+    space->count = 0;
+    while (!pq_empty(pq)) {
+        double du;
+        int u = pq_pop(pq, &du);
+        sc_settled(ctx);
+
+        if (space->count == space->cap) {
+            space->cap = space->cap ? space->cap * 2 : 64;
+            space->nodes = realloc(space->nodes, sizeof(int) * space->cap);
+            space->dist = realloc(space->dist, sizeof(double) * space->cap);
+        }
+        space->nodes[space->count] = u;
+        space->dist[space->count++] = du;
+
+        STAT_ADD(STAT_EDGES_RELAXED, offsets[u + 1] - offsets[u]);
+        for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+            int v = adjacent[e];
+            double nd = du + weights[e];
+            if (nd < sc_dist(ctx, side, v)) {
+                sc_set(ctx, side, v, nd, u, e);
+                pq_push(pq, v, nd);
+            }
+        }
+    }
+}
+
+static void bucket_matrix(Graph* graph, const int* sources, int num_sources,
+                          const int* targets, int num_targets, double* matrix) {
+    const CHGraph* ch = graph->ch;
+    int n = graph->num_nodes;
+
+    // 1. backward search spaces of all targets
+    SearchSpace* spaces = calloc(num_targets, sizeof(SearchSpace));
+    STATS_CALLER(caller);
+    #pragma omp parallel for schedule(dynamic)
+    for (int j = 0; j < num_targets; j++) {
+        STATS_CREDIT_BEGIN(credit, caller);
+        SearchContext* ctx = search_context_acquire(graph);
+        upward_search(ch, ctx, 1, targets[j], &spaces[j]);
+        STATS_CREDIT_END(credit);
+    }
+
+    // 2. bucket of node v = every (target, d(v, target)) whose backward search settled v
+    int* bucket_offsets = calloc((size_t)n + 1, sizeof(int));
+    for (int j = 0; j < num_targets; j++) {
+        for (int k = 0; k < spaces[j].count; k++) bucket_offsets[spaces[j].nodes[k] + 1]++;
+    }
+    for (int v = 0; v < n; v++) bucket_offsets[v + 1] += bucket_offsets[v];
+
+    int total = bucket_offsets[n];
+    BucketEntry* entries = malloc(sizeof(BucketEntry) * (total > 0 ? total : 1));
+    int* fill = malloc(sizeof(int) * (n > 0 ? n : 1));
+    for (int v = 0; v < n; v++) fill[v] = bucket_offsets[v];
+    for (int j = 0; j < num_targets; j++) {
+        for (int k = 0; k < spaces[j].count; k++) {
+            BucketEntry* entry = &entries[fill[spaces[j].nodes[k]]++];
+            entry->target = j;
+            entry->dist = spaces[j].dist[k];
+        }
+        free(spaces[j].nodes);
+        free(spaces[j].dist);
+    }
+    free(spaces);
+    free(fill);
+
+    // 3. forward search per source, the best meeting node gives each distance
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_sources; i++) {
+        STATS_CREDIT_BEGIN(credit, caller);
+        SearchContext* ctx = search_context_acquire(graph);
+        SearchSpace space = {NULL, NULL, 0, 0};
+        upward_search(ch, ctx, 0, sources[i], &space);
+
+        double* row = matrix + (size_t)i * num_targets;
+        for (int j = 0; j < num_targets; j++) row[j] = DBL_MAX;
+        for (int k = 0; k < space.count; k++) {
+            int u = space.nodes[k];
+            for (int b = bucket_offsets[u]; b < bucket_offsets[u + 1]; b++) {
+                double d = space.dist[k] + entries[b].dist;
+                if (d < row[entries[b].target]) row[entries[b].target] = d;
+            }
+        }
+        free(space.nodes);
+        free(space.dist);
+        STATS_CREDIT_END(credit);
+    }
+
+    free(entries);
+    free(bucket_offsets);
+}
+
+double* distance_matrix(Graph* graph, const int* sources, int num_sources,
+                        const int* targets, int num_targets) {
+    size_t cells = (size_t)num_sources * num_targets;
+    double* matrix = malloc(sizeof(double) * (cells > 0 ? cells : 1));
+
+    if (graph->ch) {
+        bucket_matrix(graph, sources, num_sources, targets, num_targets, matrix);
+    } else {
+        dijkstra_one_to_many_batch(graph, sources, num_sources, targets, num_targets, DBL_MAX, matrix);
+    }
+    return matrix;
+}
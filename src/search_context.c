@@ -0,0 +1,119 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "graph.h"
+#include "search_context.h"
+
+/******************************************************
+ * Search context
+ ******************************************************/
+
+// One context per thread, created on first use
+static SearchContext* thread_context = NULL;
+#pragma omp threadprivate(thread_context)
+
+// Every live context, and what freed ones had settled, for search_settled_total()
+static SearchContext* all_contexts = NULL;
+static unsigned long long retired_settled = 0;
+
+SearchContext* search_context_create(int capacity) {
+    SearchContext* ctx = malloc(sizeof(SearchContext));
+    size_t n = (size_t)(capacity > 0 ? capacity : 1);
+    ctx->capacity = capacity;
+    ctx->heap_kind = heap_default_kind();
+    ctx->generation = 1;
+    for (int s = 0; s < 2; s++) {
+        SearchSide* side = &ctx->side[s];
+        side->dist = malloc(sizeof(double) * n);
+        side->parent = malloc(sizeof(int) * n);
+        side->parent_edge = malloc(sizeof(int) * n);
+        side->stamp = calloc(n, sizeof(unsigned));
+        side->closed = calloc(n, sizeof(unsigned));
+        pq_init(&side->heap, capacity, ctx->heap_kind);
+    }
+    ctx->value = malloc(sizeof(double) * n);
+    ctx->value_stamp = calloc(n, sizeof(unsigned));
+    ctx->settled = 0;
+
+    #pragma omp critical(search_context_list)
+    {
+        ctx->next_context = all_contexts;
+        all_contexts = ctx;
+    }
+    return ctx;
+}
+
+void search_context_free(SearchContext* ctx) {
+    if (!ctx) return;
+    #pragma omp critical(search_context_list)
+    {
+        SearchContext** link = &all_contexts;
+        while (*link && *link != ctx) link = &(*link)->next_context;
+        if (*link) *link = ctx->next_context;
+        retired_settled += ctx->settled;
+    }
+    for (int s = 0; s < 2; s++) {
+        SearchSide* side = &ctx->side[s];
+        free(side->dist);
+        free(side->parent);
+        free(side->parent_edge);
+        free(side->stamp);
+        free(side->closed);
+        pq_free(&side->heap);
+    }
+    free(ctx->value);
+    free(ctx->value_stamp);
+    free(ctx);
+}
+
+SearchContext* search_context_acquire(const Graph* graph) {
+    if (!thread_context || thread_context->capacity < graph->num_nodes
+        || thread_context->heap_kind != heap_default_kind()) {
+        search_context_free(thread_context);
+        thread_context = search_context_create(graph->num_nodes);
+    }
+    return thread_context;
+}
+
+void search_context_begin(SearchContext* ctx) {
+    ctx->generation++;
+    if (ctx->generation == 0) {
+        // stamps wrapped around: old stamps could look current again
+        size_t n = (size_t)(ctx->capacity > 0 ? ctx->capacity : 1);
+        for (int s = 0; s < 2; s++) {
+            memset(ctx->side[s].stamp, 0, sizeof(unsigned) * n);
+            memset(ctx->side[s].closed, 0, sizeof(unsigned) * n);
+        }
+        memset(ctx->value_stamp, 0, sizeof(unsigned) * n);
+        ctx->generation = 1;
+    }
+    pq_clear(&ctx->side[0].heap);
+    pq_clear(&ctx->side[1].heap);
+}
+
+unsigned long long search_settled_total(void) {
+    unsigned long long total;
+    #pragma omp critical(search_context_list)
+    {
+        total = retired_settled;
+        for (SearchContext* ctx = all_contexts; ctx; ctx = ctx->next_context) total += ctx->settled;
+    }
+    return total;
+}
+
+int* sc_build_path(const SearchContext* ctx, int side, int v, int* out_len) {
+    int len = 0;
+    for (int cur = v; cur != -1; cur = sc_parent(ctx, side, cur)) len++;
+
+    int* path = malloc(sizeof(int) * len);
+    STAT_ADD(STAT_ALLOC_BYTES, sizeof(int) * len);
+    int idx = side == 0 ? len - 1 : 0;
+    int step = side == 0 ? -1 : 1;
+    for (int cur = v; cur != -1; cur = sc_parent(ctx, side, cur)) {
+        path[idx] = cur;
+        idx += step;
+    }
+
+    *out_len = len;
+    return path;
+}
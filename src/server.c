@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/uio.h>
+#include <omp.h>
+#include "graph.h"
+#include "handlers.h"
+#include "server.h"
+#include "logging.h"
+
+/*
+* one listening socket shared by a pool of OpenMP worker threads
+* each worker blocks in accept() and serves one connection at a time
+* the graph and building mapping are loaded once and only read afterwards
+*/
+
+static int listen_fd = -1;
+static volatile sig_atomic_t stop_requested = 0;
+
+// SIGINT/SIGTERM: wake every worker blocked in accept()
+static void handle_stop_signal(int sig) {
+    (void)sig;
+    stop_requested = 1;
+    shutdown(listen_fd, SHUT_RDWR);
+}
+
+// write() until the whole buffer is sent
+static int write_all(int fd, const char* buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, buf, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// Length line and body in one writev(), a short write is finished with write_all()
+static int send_response(int fd, const char* header, size_t header_len,
+                         const char* body, size_t body_len) {
+    struct iovec iov[2] = {
+        {(void*)header, header_len},
+        {(void*)body, body_len}
+    };
+    ssize_t n;
+    do {
+        n = writev(fd, iov, 2);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) return -1;
+
+    size_t sent = (size_t)n;
+    if (sent < header_len) {
+        if (write_all(fd, header + sent, header_len - sent) != 0) return -1;
+        return write_all(fd, body, body_len);
+    }
+    sent -= header_len;
+    return write_all(fd, body + sent, body_len - sent);
+}
+
+// Answer every query on one connection until the client hangs up
+static void serve_connection(int client_fd, Graph* campus, BuildingMapping* mapping) {
+    FILE* in = fdopen(client_fd, "r");
+    if (!in) {
+        close(client_fd);
+        return;
+    }
+
+    char* line = NULL;
+    size_t line_cap = 0;
+    char* argv[MAX_QUERY_ARGS];
+
+    while (!stop_requested && getline(&line, &line_cap, in) > 0) {
+        if (line[0] == '\n' || line[0] == '\r') continue;
+
+        int argc = split_query_line(line, argv, MAX_QUERY_ARGS);
+
+        char* body = NULL;
+        size_t body_len = 0;
+        FILE* out = open_memstream(&body, &body_len);
+        if (!out) break;
+        dispatch_request(out, campus, mapping, argc, argv);
+        fclose(out);
+
+        char header[32];
+        int header_len = snprintf(header, sizeof(header), "%zu\n", body_len);
+        int failed = send_response(client_fd, header, (size_t)header_len, body, body_len) != 0;
+        free(body);
+        if (failed) break;
+    }
+
+    free(line);
+    fclose(in);
+}
+
+int run_server(Graph* campus, BuildingMapping* mapping, const char* socket_path, int num_workers) {
+    struct sockaddr_un addr;
+    if (strlen(socket_path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "\033[31m:( Socket path too long '%s'\033[0m\n", socket_path);
+        return -1;
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, socket_path);
+    unlink(socket_path); // remove a stale socket from a previous run
+
+    if (bind(listen_fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        perror("bind/listen");
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    // No SA_RESTART so a signal also interrupts accept() in the receiving thread
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN); // a client hanging up must not kill the daemon
+
+    if (num_workers <= 0) num_workers = omp_get_num_procs();
+
+    LOG_INFO("daemon listening on %s with %d workers", socket_path, num_workers);
+
+    #pragma omp parallel num_threads(num_workers)
+    {
+        while (!stop_requested) {
+            int client_fd = accept(listen_fd, NULL, NULL);
+            if (client_fd < 0) {
+                if (errno == EINTR || errno == ECONNABORTED) continue;
+                break; // listening socket shut down
+            }
+            serve_connection(client_fd, campus, mapping);
+        }
+    }
+
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path);
+    LOG_INFO("daemon stopped");
+    return 0;
+}
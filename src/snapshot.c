@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "graph.h"
+#include "snapshot.h"
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~(uint64_t)7;
+}
+
+// Byte offset (from the end of the header) of every section, in file order
+typedef struct
+{
+    uint64_t weights, rev_weights, lat, lon, offsets, targets, rev_offsets, rev_sources;
+    uint64_t building_nodes, name_offsets, names, end;
+} SnapshotLayout;
+
+static SnapshotLayout compute_layout(const SnapshotHeader *h)
+{
+    SnapshotLayout l;
+    l.weights = 0;
+    l.rev_weights = align8(l.weights + (uint64_t)h->num_edges * sizeof(double));
+    l.lat = align8(l.rev_weights + (uint64_t)h->num_edges * sizeof(double));
+    l.lon = align8(l.lat + (uint64_t)h->num_nodes * sizeof(double));
+    l.offsets = align8(l.lon + (uint64_t)h->num_nodes * sizeof(double));
+    l.targets = align8(l.offsets + ((uint64_t)h->num_nodes + 1) * sizeof(int32_t));
+    l.rev_offsets = align8(l.targets + (uint64_t)h->num_edges * sizeof(int32_t));
+    l.rev_sources = align8(l.rev_offsets + ((uint64_t)h->num_nodes + 1) * sizeof(int32_t));
+    l.building_nodes = align8(l.rev_sources + (uint64_t)h->num_edges * sizeof(int32_t));
+    l.name_offsets = align8(l.building_nodes + (uint64_t)h->num_buildings * sizeof(int32_t));
+    l.names = align8(l.name_offsets + (uint64_t)h->num_buildings * sizeof(uint32_t));
+    l.end = align8(l.names + h->names_bytes);
+    return l;
+}
+
+// Append one section plus zero padding to the next 8-byte boundary
+static int write_section(FILE *out, const void *data, size_t len, uint64_t *hash)
+{
+    static const char zeros[8] = {0};
+    size_t pad = (size_t)(align8(len) - len);
+    if (len > 0 && fwrite(data, 1, len, out) != len)
+        return -1;
+    if (pad > 0 && fwrite(zeros, 1, pad, out) != pad)
+        return -1;
+    *hash = fnv1a(*hash, data, len);
+    *hash = fnv1a(*hash, zeros, pad);
+    return 0;
+}
+
+int write_snapshot(const char *filename, const Graph *g, const BuildingMapping *mapping)
+{
+    if (g->adjacency)
+    {
+        fprintf(stderr, "\033[31m:( Graph must be frozen before writing a snapshot\n");
+        return -1;
+    }
+
+    FILE *out = fopen(filename, "wb");
+    if (!out)
+    {
+        fprintf(stderr, "\033[31m:( Failed creating snapshot file '%s'\n", filename);
+        return -1;
+    }
+
+    // Building table: node ids, name offsets and one block of NUL-terminated names
+    int32_t *building_nodes = malloc((mapping->count + 1) * sizeof(int32_t));
+    uint32_t *name_offsets = malloc((mapping->count + 1) * sizeof(uint32_t));
+    uint64_t names_bytes = 0;
+    for (int i = 0; i < mapping->count; i++)
+    {
+        building_nodes[i] = mapping->entries[i].node_id;
+        name_offsets[i] = (uint32_t)names_bytes;
+        names_bytes += strlen(mapping->entries[i].name) + 1;
+    }
+    char *names = malloc(names_bytes + 1);
+    for (int i = 0; i < mapping->count; i++)
+    {
+        strcpy(names + name_offsets[i], mapping->entries[i].name);
+    }
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    h.version = SNAPSHOT_VERSION;
+    h.num_nodes = (uint32_t)g->num_nodes;
+    h.num_edges = (uint32_t)g->num_edges;
+    h.num_buildings = (uint32_t)mapping->count;
+    h.names_bytes = names_bytes;
+    h.payload_bytes = compute_layout(&h).end;
+    h.graph_checksum = graph_checksum(g);
+
+    // Header is rewritten once the checksum is known
+    uint64_t hash = FNV_OFFSET;
+    int failed = fwrite(&h, sizeof(h), 1, out) != 1;
+    failed = failed || write_section(out, g->weights, (size_t)g->num_edges * sizeof(double), &hash);
+    failed = failed || write_section(out, g->rev_weights, (size_t)g->num_edges * sizeof(double), &hash);
+    failed = failed || write_section(out, g->lat, (size_t)g->num_nodes * sizeof(double), &hash);
+    failed = failed || write_section(out, g->lon, (size_t)g->num_nodes * sizeof(double), &hash);
+    failed = failed || write_section(out, g->offsets, ((size_t)g->num_nodes + 1) * sizeof(int32_t), &hash);
+    failed = failed || write_section(out, g->targets, (size_t)g->num_edges * sizeof(int32_t), &hash);
+    failed = failed || write_section(out, g->rev_offsets, ((size_t)g->num_nodes + 1) * sizeof(int32_t), &hash);
+    failed = failed || write_section(out, g->rev_sources, (size_t)g->num_edges * sizeof(int32_t), &hash);
+    failed = failed || write_section(out, building_nodes, (size_t)mapping->count * sizeof(int32_t), &hash);
+    failed = failed || write_section(out, name_offsets, (size_t)mapping->count * sizeof(uint32_t), &hash);
+    failed = failed || write_section(out, names, names_bytes, &hash);
+
+    h.checksum = hash;
+    failed = failed || fseek(out, 0, SEEK_SET) != 0 || fwrite(&h, sizeof(h), 1, out) != 1;
+    failed = fclose(out) != 0 || failed;
+
+    free(building_nodes);
+    free(name_offsets);
+    free(names);
+
+    if (failed)
+    {
+        fprintf(stderr, "\033[31m:( Failed writing snapshot file '%s'\n", filename);
+        remove(filename);
+        return -1;
+    }
+    return 0;
+}
+
+Snapshot *open_snapshot(const char *filename)
+{
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0)
+        return NULL; // no snapshot, caller falls back to the CSV files
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(SnapshotHeader))
+    {
+        fprintf(stderr, "\033[31m:( Snapshot '%s' is truncated\n", filename);
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *base = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); // the mapping stays valid
+    if (base == MAP_FAILED)
+    {
+        fprintf(stderr, "\033[31m:( Failed mapping snapshot '%s'\n", filename);
+        return NULL;
+    }
+
+    const SnapshotHeader *h = base;
+    const char *payload = (const char *)base + sizeof(SnapshotHeader);
+    SnapshotLayout l = compute_layout(h);
+
+    const char *error = NULL;
+    if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        error = "not a BuzzNav snapshot";
+    else if (h->version != SNAPSHOT_VERSION)
+        error = "unsupported snapshot version";
+    else if (h->payload_bytes != l.end || sizeof(SnapshotHeader) + l.end != size)
+        error = "size does not match header";
+    if (error)
+    {
+        fprintf(stderr, "\033[31m:( Snapshot '%s': %s\n", filename, error);
+        munmap(base, size);
+        return NULL;
+    }
+
+    Snapshot *snap = malloc(sizeof(Snapshot));
+    snap->base = base;
+    snap->size = size;
+
+    Graph *g = &snap->graph;
+    memset(g, 0, sizeof(*g));
+    g->num_nodes = (int)h->num_nodes;
+    g->num_edges = (int)h->num_edges;
+    g->adjacency = NULL;
+    g->weights = (double *)(payload + l.weights);
+    g->lat = (double *)(payload + l.lat);
+    g->lon = (double *)(payload + l.lon);
+    g->offsets = (int *)(payload + l.offsets);
+    g->targets = (int *)(payload + l.targets);
+    g->rev_weights = (double *)(payload + l.rev_weights);
+    g->rev_offsets = (int *)(payload + l.rev_offsets);
+    g->rev_sources = (int *)(payload + l.rev_sources);
+    g->checksum = h->graph_checksum;
+
+    const int32_t *building_nodes = (const int32_t *)(payload + l.building_nodes);
+    const uint32_t *name_offsets = (const uint32_t *)(payload + l.name_offsets);
+    const char *names = payload + l.names;
+
+    BuildingMapping *m = &snap->mapping;
+    m->count = (int)h->num_buildings;
+    m->capacity = m->count;
+    m->grid = NULL;
+    m->entries = malloc((m->count + 1) * sizeof(BuildingEntry));
+    for (int i = 0; i < m->count; i++)
+    {
+        m->entries[i].name = (char *)(names + name_offsets[i]);
+        m->entries[i].node_id = building_nodes[i];
+    }
+    index_buildings(m);
+
+    fprintf(stderr, "\033[32m:) Mapped campus snapshot '%s' (%d nodes, %d edges, %d buildings)\033[0m\n",
+            filename, g->num_nodes, g->num_edges, m->count);
+    return snap;
+}
+
+int verify_snapshot(const Snapshot *snap)
+{
+    const SnapshotHeader *h = snap->base;
+    const char *payload = (const char *)snap->base + sizeof(SnapshotHeader);
+    return fnv1a(FNV_OFFSET, payload, h->payload_bytes) == h->checksum ? 0 : -1;
+}
+
+void close_snapshot(Snapshot *snap)
+{
+    if (!snap)
+        return;
+    free(snap->mapping.entries);
+    free_building_index(&snap->mapping);
+    munmap(snap->base, snap->size);
+    free(snap);
+}
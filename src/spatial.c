@@ -0,0 +1,334 @@
+#include <stdlib.h>
+#include <float.h>
+#include <math.h>
+#include "graph.h"
+#include "utils.h"
+#include "spatial.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+* build: counting sort of the items by cell (offsets = prefix sums of the counts)
+* nearest: rings of cells around the query cell, r = 0, 1, 2, ...
+*   every point of ring r is at least (r - 1) * cell_size away, so the search
+*   stops once that exceeds the best distance found
+* radius: every cell overlapping the query square
+*/
+
+// Automatic cells hold about this many items
+#define ITEMS_PER_CELL 2.0
+
+/******************************************************
+ * Construction
+ ******************************************************/
+
+static int cell_coord(double v, double min, double cell_size, int count) {
+    int c = (int)floor((v - min) / cell_size);
+    return c < 0 ? 0 : (c >= count ? count - 1 : c);
+}
+
+// Projection, cell size and cell counts from the points, whose projections go to px / py
+static void init_frame(SpatialGrid* grid, const double* lat, const double* lon, int num_points,
+                       int num_items, double cell_size, double* px, double* py) {
+    double min_lat = 0, max_lat = 0, min_lon = 0, max_lon = 0;
+    for (int i = 0; i < num_points; i++) {
+        if (i == 0 || lat[i] < min_lat) min_lat = lat[i];
+        if (i == 0 || lat[i] > max_lat) max_lat = lat[i];
+        if (i == 0 || lon[i] < min_lon) min_lon = lon[i];
+        if (i == 0 || lon[i] > max_lon) max_lon = lon[i];
+    }
+    grid->lat0 = (min_lat + max_lat) / 2;
+    grid->lon0 = (min_lon + max_lon) / 2;
+    grid->m_per_deg_lat = R * M_PI / 180.0;
+    grid->m_per_deg_lon = grid->m_per_deg_lat * cos(grid->lat0 * M_PI / 180.0);
+
+    double max_x = 0, max_y = 0;
+    for (int i = 0; i < num_points; i++) {
+        spatial_project(grid, lat[i], lon[i], &px[i], &py[i]);
+        if (i == 0 || px[i] < grid->min_x) grid->min_x = px[i];
+        if (i == 0 || py[i] < grid->min_y) grid->min_y = py[i];
+        if (i == 0 || px[i] > max_x) max_x = px[i];
+        if (i == 0 || py[i] > max_y) max_y = py[i];
+    }
+
+    double width = fmax(max_x - grid->min_x, 1.0);
+    double height = fmax(max_y - grid->min_y, 1.0);
+    if (cell_size <= 0) {
+        cell_size = sqrt(width * height * ITEMS_PER_CELL / (num_items > 0 ? num_items : 1));
+    }
+    // keep the cell array in proportion to the items, whatever cell size was asked for
+    double max_cells = 4.0 * num_items + 1024;
+    while ((floor(width / cell_size) + 1) * (floor(height / cell_size) + 1) > max_cells) cell_size *= 2;
+
+    grid->cell_size = cell_size;
+    grid->cols = (int)floor(width / cell_size) + 1;
+    grid->rows = (int)floor(height / cell_size) + 1;
+}
+
+SpatialGrid* spatial_grid_build(const double* lat, const double* lon, int num_items, double cell_size) {
+    SpatialGrid* grid = calloc(1, sizeof(SpatialGrid));
+    grid->num_items = num_items;
+
+    double* px = malloc(sizeof(double) * (num_items + 1));
+    double* py = malloc(sizeof(double) * (num_items + 1));
+    init_frame(grid, lat, lon, num_items, num_items, cell_size, px, py);
+    cell_size = grid->cell_size;
+
+    int num_cells = grid->cols * grid->rows;
+    int* cell_of = malloc(sizeof(int) * (num_items + 1));
+    grid->cell_offsets = calloc((size_t)num_cells + 1, sizeof(int));
+    for (int i = 0; i < num_items; i++) {
+        int cx = cell_coord(px[i], grid->min_x, cell_size, grid->cols);
+        int cy = cell_coord(py[i], grid->min_y, cell_size, grid->rows);
+        cell_of[i] = cy * grid->cols + cx;
+        grid->cell_offsets[cell_of[i] + 1]++;
+    }
+    for (int c = 0; c < num_cells; c++) grid->cell_offsets[c + 1] += grid->cell_offsets[c];
+
+    grid->items = malloc(sizeof(int) * (num_items + 1));
+    grid->x = malloc(sizeof(double) * (num_items + 1));
+    grid->y = malloc(sizeof(double) * (num_items + 1));
+    int* fill = malloc(sizeof(int) * num_cells);
+    for (int c = 0; c < num_cells; c++) fill[c] = grid->cell_offsets[c];
+    for (int i = 0; i < num_items; i++) {
+        int k = fill[cell_of[i]]++;
+        grid->items[k] = i;
+        grid->x[k] = px[i];
+        grid->y[k] = py[i];
+    }
+
+    free(fill);
+    free(cell_of);
+    free(px);
+    free(py);
+    return grid;
+}
+
+SpatialGrid* spatial_grid_for_buildings(const Graph* g, const BuildingMapping* mapping) {
+    double* lat = malloc(sizeof(double) * (mapping->count + 1));
+    double* lon = malloc(sizeof(double) * (mapping->count + 1));
+    for (int i = 0; i < mapping->count; i++) {
+        lat[i] = g->lat[mapping->entries[i].node_id];
+        lon[i] = g->lon[mapping->entries[i].node_id];
+    }
+    SpatialGrid* grid = spatial_grid_build(lat, lon, mapping->count, 0);
+    free(lat);
+    free(lon);
+    return grid;
+}
+
+void spatial_grid_free(SpatialGrid* grid) {
+    if (!grid) return;
+    free(grid->cell_offsets);
+    free(grid->items);
+    free(grid->x);
+    free(grid->y);
+    free(grid);
+}
+
+/******************************************************
+ * Queries
+ ******************************************************/
+
+int spatial_nearest(const SpatialGrid* grid, double lat, double lon, double max_dist, double* out_dist) {
+    double qx, qy;
+    spatial_project(grid, lat, lon, &qx, &qy);
+    int cx = cell_coord(qx, grid->min_x, grid->cell_size, grid->cols);
+    int cy = cell_coord(qy, grid->min_y, grid->cell_size, grid->rows);
+
+    // rings beyond this one lie completely outside the grid
+    int max_ring = cx;
+    if (grid->cols - 1 - cx > max_ring) max_ring = grid->cols - 1 - cx;
+    if (cy > max_ring) max_ring = cy;
+    if (grid->rows - 1 - cy > max_ring) max_ring = grid->rows - 1 - cy;
+
+    int best = -1;
+    double best_d2 = max_dist == DBL_MAX ? DBL_MAX : max_dist * max_dist;
+    for (int r = 0; r <= max_ring; r++) {
+        double gap = (r - 1) * grid->cell_size;
+        if (gap > 0 && gap * gap > best_d2) break;
+
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y < 0 || y >= grid->rows) continue;
+            // inner rows only contribute the two edge cells of the ring
+            int step = (y == cy - r || y == cy + r) ? 1 : 2 * r;
+            for (int x = cx - r; x <= cx + r; x += step) {
+                if (x < 0 || x >= grid->cols) continue;
+                int c = y * grid->cols + x;
+                for (int k = grid->cell_offsets[c]; k < grid->cell_offsets[c + 1]; k++) {
+                    double dx = grid->x[k] - qx, dy = grid->y[k] - qy;
+                    double d2 = dx * dx + dy * dy;
+                    if (d2 < best_d2 || (d2 == best_d2 && (best < 0 || grid->items[k] < best))) {
+                        best_d2 = d2;
+                        best = grid->items[k];
+                    }
+                }
+            }
+        }
+    }
+
+    if (out_dist) *out_dist = best >= 0 ? sqrt(best_d2) : DBL_MAX;
+    return best;
+}
+
+int spatial_radius(const SpatialGrid* grid, double lat, double lon, double radius,
+                   int* out_items, int max_items) {
+    double qx, qy;
+    spatial_project(grid, lat, lon, &qx, &qy);
+    int x0 = cell_coord(qx - radius, grid->min_x, grid->cell_size, grid->cols);
+    int x1 = cell_coord(qx + radius, grid->min_x, grid->cell_size, grid->cols);
+    int y0 = cell_coord(qy - radius, grid->min_y, grid->cell_size, grid->rows);
+    int y1 = cell_coord(qy + radius, grid->min_y, grid->cell_size, grid->rows);
+
+    int found = 0;
+    double r2 = radius * radius;
+    for (int y = y0; y <= y1; y++) {
+        for (int x = x0; x <= x1; x++) {
+            int c = y * grid->cols + x;
+            for (int k = grid->cell_offsets[c]; k < grid->cell_offsets[c + 1]; k++) {
+                double dx = grid->x[k] - qx, dy = grid->y[k] - qy;
+                if (dx * dx + dy * dy > r2) continue;
+                if (found < max_items) out_items[found] = grid->items[k];
+                found++;
+            }
+        }
+    }
+    return found;
+}
+
+/******************************************************
+ * Edge grid and snapping
+ ******************************************************/
+
+// Edge u -> v exists
+static int has_edge(const Graph* g, int u, int v) {
+    for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+        if (g->targets[e] == v) return 1;
+    }
+    return 0;
+}
+
+EdgeGrid* edge_grid_build(const Graph* g) {
+    EdgeGrid* eg = calloc(1, sizeof(EdgeGrid));
+
+    // one segment per road: two-way roads once (from < to), one-way roads in edge direction
+    eg->seg_from = malloc(sizeof(int) * (g->num_edges + 1));
+    eg->seg_to = malloc(sizeof(int) * (g->num_edges + 1));
+    for (int u = 0; u < g->num_nodes; u++) {
+        for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+            int v = g->targets[e];
+            if (v == u || (v < u && has_edge(g, v, u))) continue;
+            eg->seg_from[eg->num_segments] = u;
+            eg->seg_to[eg->num_segments++] = v;
+        }
+    }
+
+    SpatialGrid* grid = &eg->grid;
+    grid->num_items = eg->num_segments;
+    double* px = malloc(sizeof(double) * (g->num_nodes + 1));
+    double* py = malloc(sizeof(double) * (g->num_nodes + 1));
+    init_frame(grid, g->lat, g->lon, g->num_nodes, eg->num_segments, 0, px, py);
+
+    // a segment goes into every cell its bounding box touches
+    int num_cells = grid->cols * grid->rows;
+    grid->cell_offsets = calloc((size_t)num_cells + 1, sizeof(int));
+    int* fill = NULL;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int s = 0; s < eg->num_segments; s++) {
+            int a = eg->seg_from[s], b = eg->seg_to[s];
+            int x0 = cell_coord(fmin(px[a], px[b]), grid->min_x, grid->cell_size, grid->cols);
+            int x1 = cell_coord(fmax(px[a], px[b]), grid->min_x, grid->cell_size, grid->cols);
+            int y0 = cell_coord(fmin(py[a], py[b]), grid->min_y, grid->cell_size, grid->rows);
+            int y1 = cell_coord(fmax(py[a], py[b]), grid->min_y, grid->cell_size, grid->rows);
+            for (int y = y0; y <= y1; y++) {
+                for (int x = x0; x <= x1; x++) {
+                    int c = y * grid->cols + x;
+                    if (pass == 0) grid->cell_offsets[c + 1]++;
+                    else grid->items[fill[c]++] = s;
+                }
+            }
+        }
+        if (pass == 0) {
+            for (int c = 0; c < num_cells; c++) grid->cell_offsets[c + 1] += grid->cell_offsets[c];
+            grid->items = malloc(sizeof(int) * (grid->cell_offsets[num_cells] + 1));
+            fill = malloc(sizeof(int) * num_cells);
+            for (int c = 0; c < num_cells; c++) fill[c] = grid->cell_offsets[c];
+        }
+    }
+
+    free(fill);
+    free(px);
+    free(py);
+    return eg;
+}
+
+void edge_grid_free(EdgeGrid* eg) {
+    if (!eg) return;
+    free(eg->grid.cell_offsets);
+    free(eg->grid.items);
+    free(eg->seg_from);
+    free(eg->seg_to);
+    free(eg);
+}
+
+int snap_to_edge(const EdgeGrid* eg, const Graph* g, double lat, double lon,
+                 double max_dist, EdgeSnap* out) {
+    const SpatialGrid* grid = &eg->grid;
+    double qx, qy;
+    spatial_project(grid, lat, lon, &qx, &qy);
+    int cx = cell_coord(qx, grid->min_x, grid->cell_size, grid->cols);
+    int cy = cell_coord(qy, grid->min_y, grid->cell_size, grid->rows);
+
+    int max_ring = cx;
+    if (grid->cols - 1 - cx > max_ring) max_ring = grid->cols - 1 - cx;
+    if (cy > max_ring) max_ring = cy;
+    if (grid->rows - 1 - cy > max_ring) max_ring = grid->rows - 1 - cy;
+
+    // a segment is listed in every cell it touches, so ring r can only hold
+    // segment points at least (r - 1) * cell_size away, as for points
+    int best = -1;
+    double best_t = 0;
+    double best_d2 = max_dist == DBL_MAX ? DBL_MAX : max_dist * max_dist;
+    for (int r = 0; r <= max_ring; r++) {
+        double gap = (r - 1) * grid->cell_size;
+        if (gap > 0 && gap * gap > best_d2) break;
+
+        for (int y = cy - r; y <= cy + r; y++) {
+            if (y < 0 || y >= grid->rows) continue;
+            int step = (y == cy - r || y == cy + r) ? 1 : 2 * r;
+            for (int x = cx - r; x <= cx + r; x += step) {
+                if (x < 0 || x >= grid->cols) continue;
+                int c = y * grid->cols + x;
+                for (int k = grid->cell_offsets[c]; k < grid->cell_offsets[c + 1]; k++) {
+                    int s = grid->items[k];
+                    double ax, ay, bx, by;
+                    spatial_project(grid, g->lat[eg->seg_from[s]], g->lon[eg->seg_from[s]], &ax, &ay);
+                    spatial_project(grid, g->lat[eg->seg_to[s]], g->lon[eg->seg_to[s]], &bx, &by);
+
+                    double dx = bx - ax, dy = by - ay;
+                    double len2 = dx * dx + dy * dy;
+                    double t = len2 > 0 ? ((qx - ax) * dx + (qy - ay) * dy) / len2 : 0;
+                    t = t < 0 ? 0 : (t > 1 ? 1 : t);
+                    double ex = ax + t * dx - qx, ey = ay + t * dy - qy;
+                    double d2 = ex * ex + ey * ey;
+                    if (d2 < best_d2 || (d2 == best_d2 && (best < 0 || s < best))) {
+                        best_d2 = d2;
+                        best = s;
+                        best_t = t;
+                    }
+                }
+            }
+        }
+    }
+
+    if (best < 0) return -1;
+    out->from = eg->seg_from[best];
+    out->to = eg->seg_to[best];
+    out->t = best_t;
+    out->lat = g->lat[out->from] + best_t * (g->lat[out->to] - g->lat[out->from]);
+    out->lon = g->lon[out->from] + best_t * (g->lon[out->to] - g->lon[out->from]);
+    out->dist = sqrt(best_d2);
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+/*
+* thread_stats: one block per thread, written only by its thread except for
+* the shared[] counters, which helper threads add to atomically
+* totals: requests summed under a critical section, read by --stats-summary
+*/
+
+StatsBlock thread_stats;
+#pragma omp threadprivate(thread_stats)
+
+static QueryStats totals;
+static unsigned long long total_requests = 0;
+static double load_seconds = 0.0;
+
+double stats_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+void stats_mark(QueryStats* mark) {
+    for (int c = 0; c < STAT_NUM_COUNTERS; c++) {
+        unsigned long long shared;
+        #pragma omp atomic read
+        shared = thread_stats.shared[c];
+        mark->counters[c] = thread_stats.own[c] + shared;
+    }
+    for (int p = 0; p < STAT_NUM_PHASES; p++) mark->seconds[p] = thread_stats.seconds[p];
+}
+
+void stats_since(const QueryStats* mark, QueryStats* out) {
+    stats_mark(out);
+    for (int c = 0; c < STAT_NUM_COUNTERS; c++) out->counters[c] -= mark->counters[c];
+    for (int p = 0; p < STAT_NUM_PHASES; p++) out->seconds[p] -= mark->seconds[p];
+}
+
+void stats_credit_begin(StatsCredit* credit, StatsBlock* caller) {
+    credit->caller = caller;
+    memcpy(credit->start, thread_stats.own, sizeof(credit->start));
+}
+
+void stats_credit_end(StatsCredit* credit) {
+    // the calling thread's own work is already in its block
+    if (credit->caller == &thread_stats) return;
+    for (int c = 0; c < STAT_NUM_COUNTERS; c++) {
+        unsigned long long delta = thread_stats.own[c] - credit->start[c];
+        if (delta == 0) continue;
+        #pragma omp atomic
+        credit->caller->shared[c] += delta;
+    }
+}
+
+void stats_aggregate(const QueryStats* request) {
+    #pragma omp critical(stats_totals)
+    {
+        for (int c = 0; c < STAT_NUM_COUNTERS; c++) totals.counters[c] += request->counters[c];
+        for (int p = 0; p < STAT_NUM_PHASES; p++) totals.seconds[p] += request->seconds[p];
+        total_requests++;
+    }
+}
+
+void stats_totals(QueryStats* out, unsigned long long* requests) {
+    #pragma omp critical(stats_totals)
+    {
+        *out = totals;
+        *requests = total_requests;
+    }
+}
+
+void stats_set_load_time(double seconds) {
+    load_seconds = seconds;
+}
+
+double stats_load_time(void) {
+    return load_seconds;
+}
@@ -2,140 +2,161 @@
 #include <stdlib.h>
 #include <float.h>
 #include <string.h>
+#include <stdint.h>
 #include <omp.h>
 #include "graph.h"
 #include "tsp.h"
-
-// Color definitions
-#define color_direct   "\033[34m"  
-#define color_parallel "\033[33m"  
-#define color_success  "\033[32m"  
-#define color_error    "\033[31m"  
-#define color_reset    "\033[0m"
+#include "matrix.h"
+#include "cache.h"
+#include "stats.h"
+#include "tsp_heuristic.h"
+#include "logging.h"
 
 /******************************************************
- * Priority Queue for Dijkstra
+ * Held-Karp DP
  ******************************************************/
-typedef struct {
-    int node_id;
-    double distance;
-} PQNode;
-
-typedef struct {
-    PQNode* data;
-    int size;
-    int cap;
-} PQ;
-
-static PQ* pq_create(int cap) {
-    PQ* pq = malloc(sizeof(PQ));
-    pq->data = malloc(sizeof(PQNode) * cap);
-    pq->size = 0;
-    pq->cap = cap;
-    return pq;
-}
+#define HK_INF 1e18
+
+/*
+* only points whose position is free are DP states (fixed first / last points
+* are left out, which shrinks the table by a factor 2 per fixed point)
+* dp[mask * M + j]: shortest path from the first point (or from anywhere if it
+*   is free) through exactly the free points in mask, ending at free point j
+*   one contiguous table, parents as uint8_t (M stays far below 256)
+* masks of equal popcount only read the previous layer, so each layer
+*   is one parallel loop; dp entries with j outside mask stay HK_INF,
+*   which lets the inner min run over every prev without bit tests
+* first == last (>= 0) is a round trip: order holds each point once and the
+*   returned length includes the leg back to first
+*/
+double tsp_held_karp(const double* dist, int N, int first, int last, int* order) {
+    int closed = first >= 0 && first == last;
+    int* free_pts = malloc(sizeof(int) * N);
+    int M = 0;
+    for (int i = 0; i < N; i++) {
+        if (i != first && i != last) free_pts[M++] = i;
+    }
 
-static void pq_free(PQ* pq) {
-    free(pq->data);
-    free(pq);
-}
+    // order = [first] free points... [last]
+    int head = first >= 0 ? 1 : 0;
+    if (first >= 0) order[0] = first;
+    if (last >= 0 && !closed) order[N - 1] = last;
 
-static void pq_swap(PQNode* a, PQNode* b) {
-    PQNode t = *a; *a = *b; *b = t;
-}
-
-static void pq_push(PQ* pq, int id, double dist) {
-    if (pq->size >= pq->cap) return;
-    pq->data[pq->size].node_id = id;
-    pq->data[pq->size].distance = dist;
-    int i = pq->size++;
-    while (i > 0) {
-        int p = (i - 1) / 2;
-        if (pq->data[p].distance <= pq->data[i].distance) break;
-        pq_swap(&pq->data[p], &pq->data[i]);
-        i = p;
+    if (M == 0) {
+        free(free_pts);
+        return (first >= 0 && last >= 0 && !closed) ? dist[first * N + last] : 0.0;
     }
-}
 
-static int pq_empty(PQ* pq) { return pq->size == 0; }
-
-static int pq_pop(PQ* pq) {
-    if (pq->size == 0) return -1;
-    int id = pq->data[0].node_id;
-    pq->data[0] = pq->data[--pq->size];
-
-    int i = 0;
-    for (;;) {
-        int l = 2*i + 1, r = 2*i + 2, s = i;
-        if (l < pq->size && pq->data[l].distance < pq->data[s].distance) s = l;
-        if (r < pq->size && pq->data[r].distance < pq->data[s].distance) s = r;
-        if (s == i) break;
-        pq_swap(&pq->data[i], &pq->data[s]);
-        i = s;
-    }
-    return id;
-}
+    size_t full = (size_t)1 << M;
+    double* dp = malloc(sizeof(double) * full * M);
+    uint8_t* parent = malloc(sizeof(uint8_t) * full * M);
 
-/******************************************************
- * Dijkstra
- ******************************************************/
-static void dijkstra(Graph* g, int src, double* dist, int* prev) {
-    int n = g->num_nodes;
-    int* vis = calloc(n, sizeof(int));
+    // into[j * M + prev] = dist[prev][j]: contiguous over prev for the inner loop
+    double* into = malloc(sizeof(double) * M * M);
+    for (int prev = 0; prev < M; prev++) {
+        for (int j = 0; j < M; j++) into[j * M + prev] = dist[free_pts[prev] * N + free_pts[j]];
+    }
 
-    for (int i = 0; i < n; i++) {
-        dist[i] = DBL_MAX;
-        prev[i] = -1;
+    // masks grouped by popcount
+    int* layer_start = calloc(M + 2, sizeof(int));
+    int* masks = malloc(sizeof(int) * full);
+    for (size_t mask = 0; mask < full; mask++) layer_start[__builtin_popcount((unsigned)mask) + 1]++;
+    for (int k = 0; k <= M; k++) layer_start[k + 1] += layer_start[k];
+    int* fill = malloc(sizeof(int) * (M + 1));
+    memcpy(fill, layer_start, sizeof(int) * (M + 1));
+    for (size_t mask = 0; mask < full; mask++) masks[fill[__builtin_popcount((unsigned)mask)]++] = (int)mask;
+    free(fill);
+
+    #pragma omp parallel for schedule(static)
+    for (size_t i = 0; i < full * M; i++) dp[i] = HK_INF;
+
+    // seeds: a fixed first point pays its leg, a free start costs nothing
+    for (int j = 0; j < M; j++) {
+        dp[((size_t)1 << j) * M + j] = first >= 0 ? dist[first * N + free_pts[j]] : 0;
     }
-    dist[src] = 0;
-
-    PQ* pq = pq_create(n);
-    pq_push(pq, src, 0);
-
-    while (!pq_empty(pq)) {
-        int u = pq_pop(pq);
-        if (vis[u]) continue;
-        vis[u] = 1;
-
-        for (Edge* e = g->nodes[u].neighbors; e; e = e->next) {
-            int v = e->to;
-            double nd = dist[u] + e->weight;
-            if (nd < dist[v]) {
-                dist[v] = nd;
-                prev[v] = u;
-                pq_push(pq, v, nd);
+
+    for (int k = 2; k <= M; k++) {
+        #pragma omp parallel for schedule(dynamic, 64)
+        for (int idx = layer_start[k]; idx < layer_start[k + 1]; idx++) {
+            int mask = masks[idx];
+            for (int j = 0; j < M; j++) {
+                if (!(mask & (1 << j))) continue;
+
+                const double* prev_dp = dp + (size_t)(mask ^ (1 << j)) * M;
+                const double* to_j = into + j * M;
+
+                double best = HK_INF;
+                #pragma omp simd reduction(min:best)
+                for (int prevb = 0; prevb < M; prevb++) {
+                    double c = prev_dp[prevb] + to_j[prevb];
+                    best = c < best ? c : best;
+                }
+                if (best >= HK_INF) continue;
+
+                // the first prev whose sum is best; bounded so a sum that does not
+                // reproduce best bit for bit can never run past the row
+                int arg = 0;
+                while (arg < M - 1 && prev_dp[arg] + to_j[arg] != best) arg++;
+                dp[(size_t)mask * M + j] = best;
+                parent[(size_t)mask * M + j] = (uint8_t)arg;
             }
         }
     }
 
-    free(vis);
-    pq_free(pq);
-}
-
-/******************************************************
- * Reconstruct path
- ******************************************************/
-static int* build_path(int* prev, int src, int dst, int* out_len) {
-    if (src != dst && prev[dst] == -1) {
-        *out_len = 0;
-        return NULL;
+    // a fixed last point (or the way back on a round trip) pays its leg
+    size_t last_mask = full - 1;
+    int end = 0;
+    double best = HK_INF;
+    for (int j = 0; j < M; j++) {
+        double c = dp[last_mask * M + j];
+        if (last >= 0) c += dist[free_pts[j] * N + last];
+        if (c < best) {
+            best = c;
+            end = j;
+        }
     }
 
-    int len = 0;
-    for (int cur = dst; cur != -1; cur = prev[cur]) {
-        len++;
-        if (cur == src) break;
+    if (best < HK_INF) {
+        size_t m = last_mask;
+        int cur = end;
+        for (int i = M - 1; i >= 0; i--) {
+            order[head + i] = free_pts[cur];
+            int p = parent[m * M + cur];
+            m ^= (size_t)1 << cur;
+            cur = p;
+        }
     }
 
-    int* p = malloc(sizeof(int) * len);
-    int idx = len - 1;
-    for (int cur = dst; cur != -1; cur = prev[cur]) {
-        p[idx--] = cur;
-        if (cur == src) break;
+    free(dp);
+    free(parent);
+    free(into);
+    free(layer_start);
+    free(masks);
+    free(free_pts);
+    return best;
+}
+
+// Heuristic order; a round trip becomes a path to a copy of its first point
+static double heuristic_order(const double* dist, int N, int first, int last,
+                              double time_budget, int* order) {
+    if (!(first >= 0 && first == last)) {
+        return tsp_heuristic(dist, N, first, last, time_budget, order);
     }
 
-    *out_len = len;
-    return p;
+    int n = N + 1;
+    double* ext = malloc(sizeof(double) * n * n);
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            int a = i == N ? first : i, b = j == N ? first : j;
+            ext[i * n + j] = (i == N && j == N) ? 0.0 : dist[a * N + b];
+        }
+    }
+    int* ext_order = malloc(sizeof(int) * n);
+    double best = tsp_heuristic(ext, n, first, N, time_budget, ext_order);
+    memcpy(order, ext_order, sizeof(int) * N);
+    free(ext_order);
+    free(ext);
+    return best;
 }
 
 /******************************************************
@@ -146,217 +167,128 @@ int find_optimal_multi_building_route(
     BuildingMapping* mapping,
     const char** names,
     int N,
+    PathSearchFn search,
+    const TspOptions* tsp,
     double* out_dist,
     int** out_path,
-    int* out_len
+    int* out_len,
+    int* out_order
 ) {
+    TspSolver solver = tsp ? tsp->solver : TSP_SOLVER_AUTO;
+    TspMode mode = tsp ? tsp->mode : TSP_MODE_OPEN;
+    double time_budget = tsp ? tsp->time_budget : TSP_HEURISTIC_DEFAULT_BUDGET;
+
+    // fixed points: names[0] is the start, names[N-1] the end
+    int first = mode == TSP_MODE_OPEN ? -1 : 0;
+    int last = mode == TSP_MODE_FIXED_ENDS ? N - 1 : (mode == TSP_MODE_ROUND_TRIP ? 0 : -1);
+    int closed = mode == TSP_MODE_ROUND_TRIP;
+    int num_free = N - (first >= 0) - (last >= 0 && last != first);
+
+    if (solver == TSP_SOLVER_AUTO) {
+        solver = num_free <= TSP_AUTO_EXACT_MAX ? TSP_SOLVER_EXACT : TSP_SOLVER_HEURISTIC;
+    }
+    if (solver == TSP_SOLVER_EXACT && num_free > TSP_EXACT_MAX_BUILDINGS) {
+        LOG_ERROR("tsp: exact solver supports at most %d buildings with a free position", TSP_EXACT_MAX_BUILDINGS);
+        return -1;
+    }
+
     int* ids = malloc(sizeof(int) * N);
     for (int i = 0; i < N; i++) {
         ids[i] = get_building_id(mapping, names[i]);
         if (ids[i] < 0) {
-            fprintf(stderr, "Building not found: %s\n", names[i]);
+            LOG_WARN("tsp: building not found: %s", names[i]);
             free(ids);
             return -1;
         }
     }
 
-    printf(color_parallel"Computing pairwise distances using Dijkstra (parallel with OpenMP)...\n"color_reset);
+    if (!search) search = astar;
 
-    double** dist = malloc(sizeof(double*) * N);
-    int*** segs = malloc(sizeof(int**) * N);
-    int** seglen = malloc(sizeof(int*) * N);
-
-    // Parallelize Dijkstra computation
+    // Distances only: paths are searched afterwards for the legs of the chosen order
     double start_time = omp_get_wtime();
-    
-    #pragma omp parallel for schedule(dynamic)
-    for (int i = 0; i < N; i++) {
-        // Each thread needs independent temporary arrays
-        double* d_local = malloc(sizeof(double) * graph->num_nodes);
-        int* prev_local = malloc(sizeof(int) * graph->num_nodes);
-        
-        dist[i] = malloc(sizeof(double) * N);
-        segs[i] = malloc(sizeof(int*) * N);
-        seglen[i] = malloc(sizeof(int) * N);
-
-        // Show computation progress
-        int thread_id = omp_get_thread_num();
-        printf(color_parallel"[Thread %d] Computing distances from building %d (%s)\n"color_reset,
-               thread_id, i, names[i]);
-
-        dijkstra(graph, ids[i], d_local, prev_local);
-
-        for (int j = 0; j < N; j++) {
-            if (i == j) {
-                dist[i][j] = 0;
-                segs[i][j] = NULL;
-                seglen[i][j] = 0;
-                continue;
-            }
-
-            if (d_local[ids[j]] == DBL_MAX) {
-                dist[i][j] = 1e15;  
-                segs[i][j] = NULL;
-                seglen[i][j] = 0;
-            } else {
-                dist[i][j] = d_local[ids[j]];
-                segs[i][j] = build_path(prev_local, ids[i], ids[j], &seglen[i][j]);
-            }
-        }
-        
-        printf(color_success"[Thread %d] Building %d complete\n"color_reset, thread_id, i);
-        
-        free(d_local);
-        free(prev_local);
-    }
-    
+    double* dist = distance_matrix(graph, ids, N, ids, N);
     double end_time = omp_get_wtime();
-    printf(color_parallel"Parallel computation finished! Time: %.3f seconds\n"color_reset, end_time - start_time);
-    printf(color_success"Pairwise matrix computed.\n"color_reset);
+    LOG_DEBUG("tsp: %d x %d distance matrix in %.3f s", N, N, end_time - start_time);
 
     /******************************************************
-     * Held-Karp (TSP DP)
+     * Visiting order: Held-Karp or local search
      ******************************************************/
-    printf(color_parallel"Solving TSP using Held-Karp...\n"color_reset);
-
-    int FULL = 1 << N;
-    double** dp = malloc(sizeof(double*) * FULL);
-    int** parent = malloc(sizeof(int*) * FULL);
-
-    for (int m = 0; m < FULL; m++) {
-        dp[m] = malloc(sizeof(double) * N);
-        parent[m] = malloc(sizeof(int) * N);
-        for (int i = 0; i < N; i++) {
-            dp[m][i] = 1e18;
-            parent[m][i] = -1;
-        }
-    }
-
-    for (int i = 0; i < N; i++) {
-        dp[1 << i][i] = 0;
-    }
-
-    for (int mask = 1; mask < FULL; mask++) {
-        for (int last = 0; last < N; last++) {
-            if (!(mask & (1 << last))) continue;
-
-            int pm = mask ^ (1 << last);
-            if (pm == 0) continue;
-
-            for (int prevb = 0; prevb < N; prevb++) {
-                if (!(pm & (1 << prevb))) continue;
-
-                double c = dp[pm][prevb] + dist[prevb][last];
-                if (c < dp[mask][last]) {
-                    dp[mask][last] = c;
-                    parent[mask][last] = prevb;
-                }
-            }
-        }
-    }
-
-    int last = -1;
-    double best = 1e18;
-    for (int i = 0; i < N; i++) {
-        if (dp[FULL - 1][i] < best) {
-            best = dp[FULL - 1][i];
-            last = i;
-        }
+    int* order = malloc(sizeof(int) * N);
+    double best;
+    if (solver == TSP_SOLVER_EXACT) {
+        LOG_DEBUG("tsp: solving %d buildings with Held-Karp", N);
+        best = tsp_held_karp(dist, N, first, last, order);
+    } else {
+        LOG_DEBUG("tsp: solving %d buildings heuristically, budget %.3f s", N, time_budget);
+        best = heuristic_order(dist, N, first, last, time_budget, order);
     }
 
     if (best > 1e14) {
-        fprintf(stderr, color_error"ERROR: Not all buildings are reachable in the graph.\n"color_reset);
+        LOG_WARN("tsp: not all buildings are reachable in the graph");
         
         // Clean up memory
-        for (int mask = 0; mask < FULL; mask++) {
-            free(dp[mask]);
-            free(parent[mask]);
-        }
-        free(dp);
-        free(parent);
-        
-        for (int i = 0; i < N; i++) {
-            for (int j = 0; j < N; j++) free(segs[i][j]);
-            free(segs[i]);
-            free(seglen[i]);
-            free(dist[i]);
-        }
-        free(segs);
-        free(seglen);
+        free(order);
         free(dist);
         free(ids);
         
         return -1;
     }
 
-    int* order = malloc(sizeof(int) * N);
-    int m = FULL - 1, cur = last;
-    for (int i = N - 1; i >= 0; i--) {
-        order[i] = cur;
-        int p = parent[m][cur];
-        m ^= (1 << cur);
-        cur = p;
-    }
-
     /******************************************************
-     * Build full node path
+     * Search and merge the legs of the chosen order
      ******************************************************/
-    printf(color_success"Merging segments...\n"color_reset);
-    
+    // a round trip adds the leg back to the start
+    int num_legs = closed ? N : N - 1;
+    int** segs = calloc(num_legs, sizeof(int*));
+    int* seglen = calloc(num_legs, sizeof(int));
+
+    STATS_CALLER(caller);
+    #pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < num_legs; i++) {
+        STATS_CREDIT_BEGIN(credit, caller);
+        cached_search(search, graph, ids[order[i]], ids[order[(i + 1) % N]], &segs[i], &seglen[i]);
+        STATS_CREDIT_END(credit);
+    }
+
     int total = 0;
-    for (int i = 0; i < N - 1; i++) {
-        int a = order[i], b = order[i+1];
-        if (i == 0) {
-            total += seglen[a][b];  
-        } else {
-            total += seglen[a][b] - 1; 
-        }
+    for (int i = 0; i < num_legs; i++) {
+        total += (i == 0) ? seglen[i] : seglen[i] - 1;
     }
 
-    int* full = malloc(sizeof(int) * total);
+    int* full = malloc(sizeof(int) * (total > 0 ? total : 1));
+    STAT_ADD(STAT_ALLOC_BYTES, sizeof(int) * (total > 0 ? total : 1));
     int idx = 0;
 
-    for (int i = 0; i < N - 1; i++) {
-        int a = order[i], b = order[i+1];
-        
+    for (int i = 0; i < num_legs; i++) {
         int start = (i == 0) ? 0 : 1;
         
-        for (int j = start; j < seglen[a][b]; j++) {
-            full[idx++] = segs[a][b][j];
+        for (int j = start; j < seglen[i]; j++) {
+            full[idx++] = segs[i][j];
         }
+        free(segs[i]);
     }
+    free(segs);
+    free(seglen);
 
     *out_dist = best;
     *out_path = full;
     *out_len = idx;
-
-    printf("\n");
-    printf(color_success"=== Optimal Route Found ===\n"color_reset);
-    printf(color_success"Total Distance: %.2f m\n"color_reset, best);
-    printf(color_success"Total Nodes: %d\n"color_reset, idx);
-    printf(color_success"Visit Order: "color_reset);
-    for (int i = 0; i < N; i++) {
-        printf("%s", names[order[i]]);
-        if (i < N - 1) printf(" -> ");
+    if (out_order) memcpy(out_order, order, sizeof(int) * N);
+
+    if (LOG_ENABLED(LOG_LEVEL_INFO)) {
+        // visit order, cut at the record size
+        char visits[LOG_MESSAGE_MAX];
+        int used = 0;
+        for (int i = 0; i <= N && used < (int)sizeof(visits); i++) {
+            if (i == N && !closed) break;
+            used += snprintf(visits + used, sizeof(visits) - used, "%s%s",
+                             i > 0 ? " -> " : "", names[order[i % N]]);
+        }
+        LOG_INFO("tsp: %s route, %.2f m, %d nodes: %s",
+                 solver == TSP_SOLVER_EXACT ? "optimal" : "heuristic", best, idx, visits);
     }
-    printf("\n");
 
     // Clean up memory
-    for (int mask = 0; mask < FULL; mask++) {
-        free(dp[mask]);
-        free(parent[mask]);
-    }
-    free(dp);
-    free(parent);
-
-    for (int i = 0; i < N; i++) {
-        for (int j = 0; j < N; j++) free(segs[i][j]);
-        free(segs[i]);
-        free(seglen[i]);
-        free(dist[i]);
-    }
-    free(segs);
-    free(seglen);
     free(dist);
 
     free(order);
@@ -0,0 +1,402 @@
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <omp.h>
+#include "tsp_heuristic.h"
+
+#define NEIGHBOR_COUNT 10
+#define OR_OPT_MAX_SEGMENT 3
+#define UNREACHABLE_COST 1e9 // finite stand-in for DBL_MAX so path sums stay comparable
+#define MIN_GAIN 1e-7
+#define GAIN_PRECISION 1e-12 // relative to the largest possible path cost
+#define RESTART_INTERVAL 16 // kicks without a new best before a random restart
+
+typedef struct {
+    int n;
+    const double* cost;   // n x n, unreachable pairs at UNREACHABLE_COST
+    int first, last;      // fixed endpoints, -1 if free
+    const int* neighbors; // n x k nearest points (by the cheaper direction)
+    int k;
+    double min_gain;      // smallest gain worth a move, above the rounding of path sums
+    double deadline;
+} Instance;
+
+typedef struct {
+    int* order;
+    int* pos;       // position of each point in order
+    double* fwd;    // fwd[i] = cost of order[0..i] walked forwards
+    double* bwd;    // bwd[i] = cost of order[0..i] walked backwards
+    int* scratch;
+    char* used;
+} Path;
+
+static inline double cost(const Instance* in, int a, int b) {
+    return in->cost[(size_t)a * in->n + b];
+}
+
+// Cost of the edge a -> b, 0 when either end is the open end of the path
+static inline double link(const Instance* in, int a, int b) {
+    return (a < 0 || b < 0) ? 0.0 : cost(in, a, b);
+}
+
+static inline unsigned next_random(unsigned* state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+/******************************************************
+ * Path bookkeeping
+ ******************************************************/
+
+static void path_alloc(Path* p, int n) {
+    p->order = malloc(sizeof(int) * n);
+    p->pos = malloc(sizeof(int) * n);
+    p->fwd = malloc(sizeof(double) * n);
+    p->bwd = malloc(sizeof(double) * n);
+    p->scratch = malloc(sizeof(int) * n);
+    p->used = malloc(n);
+}
+
+static void path_free(Path* p) {
+    free(p->order);
+    free(p->pos);
+    free(p->fwd);
+    free(p->bwd);
+    free(p->scratch);
+    free(p->used);
+}
+
+static void path_refresh(const Instance* in, Path* p) {
+    p->fwd[0] = p->bwd[0] = 0.0;
+    p->pos[p->order[0]] = 0;
+    for (int i = 1; i < in->n; i++) {
+        int a = p->order[i - 1], b = p->order[i];
+        p->fwd[i] = p->fwd[i - 1] + cost(in, a, b);
+        p->bwd[i] = p->bwd[i - 1] + cost(in, b, a);
+        p->pos[b] = i;
+    }
+}
+
+static void path_copy(const Instance* in, Path* to, const Path* from) {
+    memcpy(to->order, from->order, sizeof(int) * in->n);
+    memcpy(to->pos, from->pos, sizeof(int) * in->n);
+    memcpy(to->fwd, from->fwd, sizeof(double) * in->n);
+    memcpy(to->bwd, from->bwd, sizeof(double) * in->n);
+}
+
+static inline double path_length(const Instance* in, const Path* p) {
+    return p->fwd[in->n - 1];
+}
+
+/******************************************************
+ * Construction
+ ******************************************************/
+
+// Greedy nearest neighbor from start (the fixed first point if there is one)
+static void construct_nearest(const Instance* in, Path* p, int start) {
+    int n = in->n;
+    int end = in->last >= 0 ? n - 1 : n;
+    memset(p->used, 0, n);
+
+    int cur = in->first >= 0 ? in->first : start;
+    if (cur == in->last) cur = (cur + 1) % n;
+    if (in->last >= 0) {
+        p->used[in->last] = 1;
+        p->order[n - 1] = in->last;
+    }
+    p->used[cur] = 1;
+    p->order[0] = cur;
+
+    for (int idx = 1; idx < end; idx++) {
+        int best = -1;
+        for (int v = 0; v < n; v++) {
+            if (!p->used[v] && (best == -1 || cost(in, cur, v) < cost(in, cur, best))) best = v;
+        }
+        p->used[best] = 1;
+        p->order[idx] = best;
+        cur = best;
+    }
+    path_refresh(in, p);
+}
+
+// Random order of the free points (restarts, and kicks when too few points for a double bridge)
+static void shuffle_free_points(const Instance* in, Path* p, unsigned* rng) {
+    int lo = in->first >= 0 ? 1 : 0;
+    int hi = in->last >= 0 ? in->n - 2 : in->n - 1;
+    for (int i = hi; i > lo; i--) {
+        int j = lo + (int)(next_random(rng) % (unsigned)(i - lo + 1));
+        int t = p->order[i];
+        p->order[i] = p->order[j];
+        p->order[j] = t;
+    }
+    path_refresh(in, p);
+}
+
+/******************************************************
+ * 2-opt: reverse order[i..j]
+ ******************************************************/
+
+static double reverse_delta(const Instance* in, const Path* p, int i, int j) {
+    const int* o = p->order;
+    double delta = (p->bwd[j] - p->bwd[i]) - (p->fwd[j] - p->fwd[i]);
+    if (i > 0) delta += cost(in, o[i - 1], o[j]) - cost(in, o[i - 1], o[i]);
+    if (j < in->n - 1) delta += cost(in, o[i], o[j + 1]) - cost(in, o[j], o[j + 1]);
+    return delta;
+}
+
+static int try_reverse(const Instance* in, Path* p, int i, int j) {
+    if (in->first >= 0 && i == 0) return 0;
+    if (in->last >= 0 && j == in->n - 1) return 0;
+    if (reverse_delta(in, p, i, j) >= -in->min_gain) return 0;
+
+    for (int lo = i, hi = j; lo < hi; lo++, hi--) {
+        int t = p->order[lo];
+        p->order[lo] = p->order[hi];
+        p->order[hi] = t;
+    }
+    path_refresh(in, p);
+    return 1;
+}
+
+// Moves that make a point adjacent to one of its neighbors, in either direction
+static int two_opt(const Instance* in, Path* p) {
+    int improved = 0;
+    for (int a = 0; a < in->n; a++) {
+        for (int m = 0; m < in->k; m++) {
+            int c = in->neighbors[a * in->k + m];
+            int pa = p->pos[a], pc = p->pos[c];
+            if (pc > pa + 1) {
+                improved |= try_reverse(in, p, pa + 1, pc); // a -> c
+            } else if (pc < pa - 1) {
+                improved |= try_reverse(in, p, pc, pa - 1); // c -> a
+            }
+        }
+    }
+    return improved;
+}
+
+/******************************************************
+ * Or-opt: move order[i..i+len-1] between x and y
+ ******************************************************/
+
+static int try_move(const Instance* in, Path* p, int i, int len, double removed, int x, int y) {
+    int s0 = p->order[i], sl = p->order[i + len - 1];
+    double added = link(in, x, s0) + link(in, sl, y) - link(in, x, y);
+    if (added - removed >= -in->min_gain) return 0;
+
+    int w = 0;
+    if (x == -1) {
+        for (int s = 0; s < len; s++) p->scratch[w++] = p->order[i + s];
+    }
+    for (int r = 0; r < in->n; r++) {
+        if (r >= i && r < i + len) continue;
+        p->scratch[w++] = p->order[r];
+        if (p->order[r] == x) {
+            for (int s = 0; s < len; s++) p->scratch[w++] = p->order[i + s];
+        }
+    }
+    memcpy(p->order, p->scratch, sizeof(int) * in->n);
+    path_refresh(in, p);
+    return 1;
+}
+
+static int or_opt(const Instance* in, Path* p) {
+    int n = in->n;
+    int improved = 0;
+    for (int len = 1; len <= OR_OPT_MAX_SEGMENT && len < n; len++) {
+        for (int i = 0; i + len <= n; i++) {
+            if (in->first >= 0 && i == 0) continue;
+            if (in->last >= 0 && i + len == n) continue;
+
+            int s0 = p->order[i], sl = p->order[i + len - 1];
+            int prev = i > 0 ? p->order[i - 1] : -1;
+            int next = i + len < n ? p->order[i + len] : -1;
+            double removed = link(in, prev, s0) + link(in, sl, next) - link(in, prev, next);
+
+            int moved = 0;
+            for (int m = 0; m < in->k && !moved; m++) {
+                // after a neighbor of the segment's first point
+                int c = in->neighbors[s0 * in->k + m];
+                int pc = p->pos[c];
+                if (c != prev && (pc < i || pc >= i + len)) {
+                    int y = pc + 1 < n ? p->order[pc + 1] : -1;
+                    if (y != -1 || in->last < 0) moved = try_move(in, p, i, len, removed, c, y);
+                }
+                if (moved) break;
+
+                // before a neighbor of the segment's last point
+                c = in->neighbors[sl * in->k + m];
+                pc = p->pos[c];
+                if (c != next && (pc < i || pc >= i + len)) {
+                    int x = pc > 0 ? p->order[pc - 1] : -1;
+                    if (x != -1 || in->first < 0) moved = try_move(in, p, i, len, removed, x, c);
+                }
+            }
+
+            // open ends of the path
+            if (!moved && in->first < 0 && i > 0) moved = try_move(in, p, i, len, removed, -1, p->order[0]);
+            if (!moved && in->last < 0 && i + len < n) moved = try_move(in, p, i, len, removed, p->order[n - 1], -1);
+            improved |= moved;
+        }
+    }
+    return improved;
+}
+
+static void local_search(const Instance* in, Path* p) {
+    int changed = 1;
+    while (changed && omp_get_wtime() < in->deadline) {
+        changed = two_opt(in, p);
+        changed |= or_opt(in, p);
+    }
+}
+
+/******************************************************
+ * Perturbation: double bridge A B C D -> A C B D
+ ******************************************************/
+// Cut points stay inside 1..n-1, so the first and last point never move
+static void double_bridge(const Instance* in, Path* p, unsigned* rng) {
+    int n = in->n;
+    int cut[3];
+    for (int k = 0; k < 3; k++) {
+        int c;
+        do {
+            c = 1 + (int)(next_random(rng) % (unsigned)(n - 1));
+        } while ((k > 0 && c == cut[0]) || (k > 1 && c == cut[1]));
+        cut[k] = c;
+    }
+    for (int a = 0; a < 2; a++) {
+        for (int b = 0; b < 2 - a; b++) {
+            if (cut[b] > cut[b + 1]) { int t = cut[b]; cut[b] = cut[b + 1]; cut[b + 1] = t; }
+        }
+    }
+
+    int w = 0;
+    for (int r = 0; r < cut[0]; r++) p->scratch[w++] = p->order[r];
+    for (int r = cut[1]; r < cut[2]; r++) p->scratch[w++] = p->order[r];
+    for (int r = cut[0]; r < cut[1]; r++) p->scratch[w++] = p->order[r];
+    for (int r = cut[2]; r < n; r++) p->scratch[w++] = p->order[r];
+    memcpy(p->order, p->scratch, sizeof(int) * n);
+    path_refresh(in, p);
+}
+
+/******************************************************
+ * Multi-start driver
+ ******************************************************/
+
+// k nearest points of every point, by the cheaper of the two directions
+static int* build_neighbors(const Instance* in, int k) {
+    int n = in->n;
+    int* neighbors = malloc(sizeof(int) * (size_t)n * (k > 0 ? k : 1));
+    double* keys = malloc(sizeof(double) * (k > 0 ? k : 1));
+    for (int a = 0; a < n; a++) {
+        int* list = neighbors + (size_t)a * k;
+        int count = 0;
+        for (int b = 0; b < n; b++) {
+            if (b == a) continue;
+            double d = cost(in, a, b) < cost(in, b, a) ? cost(in, a, b) : cost(in, b, a);
+            if (count == k && d >= keys[k - 1]) continue;
+
+            int slot = count < k ? count++ : k - 1;
+            while (slot > 0 && keys[slot - 1] > d) {
+                keys[slot] = keys[slot - 1];
+                list[slot] = list[slot - 1];
+                slot--;
+            }
+            keys[slot] = d;
+            list[slot] = b;
+        }
+    }
+    free(keys);
+    return neighbors;
+}
+
+double tsp_heuristic(const double* dist, int N, int first, int last,
+                     double time_budget, int* order) {
+    if (N <= 0) return 0.0;
+    if (N == 1) {
+        order[0] = 0;
+        return 0.0;
+    }
+
+    double* costs = malloc(sizeof(double) * (size_t)N * N);
+    double max_cost = 0.0;
+    for (size_t i = 0; i < (size_t)N * N; i++) {
+        costs[i] = dist[i] == DBL_MAX ? UNREACHABLE_COST : dist[i];
+        if (costs[i] > max_cost) max_cost = costs[i];
+    }
+
+    Instance in;
+    in.n = N;
+    in.cost = costs;
+    in.first = first;
+    in.last = last;
+    in.k = N - 1 < NEIGHBOR_COUNT ? N - 1 : NEIGHBOR_COUNT;
+    int* neighbors = build_neighbors(&in, in.k);
+    in.neighbors = neighbors;
+    in.min_gain = GAIN_PRECISION * max_cost * N > MIN_GAIN ? GAIN_PRECISION * max_cost * N : MIN_GAIN;
+    in.deadline = omp_get_wtime() + time_budget;
+    int max_stale = 50 + 10 * N; // restarts without improvement before a thread gives up
+    double best_len = DBL_MAX;
+
+    #pragma omp parallel
+    {
+        int thread_id = omp_get_thread_num();
+        unsigned rng = 2463534242u + 7919u * (unsigned)thread_id;
+        Path best, cur, trial;
+        path_alloc(&best, N);
+        path_alloc(&cur, N);
+        path_alloc(&trial, N);
+
+        construct_nearest(&in, &cur, thread_id % N);
+        local_search(&in, &cur);
+        path_copy(&in, &best, &cur);
+
+        // iterated local search; a stuck walk restarts from a random order
+        int stale = 0;
+        while (stale < max_stale && omp_get_wtime() < in.deadline) {
+            path_copy(&in, &trial, &cur);
+            if (N >= 8) double_bridge(&in, &trial, &rng);
+            else shuffle_free_points(&in, &trial, &rng);
+            local_search(&in, &trial);
+
+            if (path_length(&in, &trial) < path_length(&in, &cur) - in.min_gain) {
+                Path t = cur; cur = trial; trial = t;
+            }
+            if (path_length(&in, &cur) < path_length(&in, &best) - in.min_gain) {
+                path_copy(&in, &best, &cur);
+                stale = 0;
+            } else if (++stale % RESTART_INTERVAL == 0) {
+                shuffle_free_points(&in, &cur, &rng);
+                local_search(&in, &cur);
+            }
+        }
+
+        #pragma omp critical(tsp_heuristic_best)
+        {
+            if (path_length(&in, &best) < best_len) {
+                best_len = path_length(&in, &best);
+                memcpy(order, best.order, sizeof(int) * N);
+            }
+        }
+        path_free(&best);
+        path_free(&cur);
+        path_free(&trial);
+    }
+
+    double total = 0.0;
+    for (int i = 0; i + 1 < N; i++) {
+        double d = dist[(size_t)order[i] * N + order[i + 1]];
+        if (d == DBL_MAX) {
+            total = DBL_MAX;
+            break;
+        }
+        total += d;
+    }
+
+    free(costs);
+    free(neighbors);
+    return total;
+}
@@ -1,8 +1,10 @@
 #include <stdio.h>
+#include <float.h>
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include "utils.h"
+#include "json.h"
 
 // Haversine Distance
 double haversine(double lat1, double lon1, double lat2, double lon2) {
@@ -31,6 +33,9 @@ void init_result(NavigationResult* res) {
     res->instruction_count = 0;
     res->status_code = 0;
     res->error_message = NULL;
+    res->has_start = 0;
+    res->has_end = 0;
+    res->stats_mark = NULL;
 }
 
 void free_result(NavigationResult* res) {
@@ -45,56 +50,292 @@ void free_result(NavigationResult* res) {
     // but if you malloc it, free it here.
 }
 
-void print_json_error(const char* message) {
-    // We print the JSON structure to STDOUT for the Python API to catch
-    printf("{\n");
-    printf("  \"status\": \"error\",\n");
-    printf("  \"message\": \"%s\"\n", message);
-    printf("}\n");
+// --- JSON Output ---
+// Every response is built in this thread's JsonBuf and written in one go
+
+// [lat, lon] with printf's %f precision
+static void json_coordinate(JsonBuf* b, double lat, double lon) {
+    json_buf_char(b, '[');
+    json_buf_fixed(b, lat, 6);
+    json_buf_literal(b, ", ");
+    json_buf_fixed(b, lon, 6);
+    json_buf_char(b, ']');
 }
 
-void print_json_response(NavigationResult* res, Graph* campus) {
-    if (res->status_code != 0) {
-        print_json_error(res->error_message ? res->error_message : "Unknown error");
-        return;
+void print_json_error(FILE* out, const char* message) {
+    // We print the JSON structure to the response stream for the Python API to catch
+    JsonBuf* b = json_thread_buffer();
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"error\",\n");
+    json_buf_literal(b, "  \"message\": ");
+    json_buf_string(b, message);
+    json_buf_literal(b, "\n}\n");
+    json_buf_write(b, out);
+}
+
+int path_format_from_name(const char* name, PathFormat* out) {
+    static const struct { const char* name; PathFormat format; } formats[] = {
+        {"json", PATH_FORMAT_COORDINATES},
+        {"polyline5", PATH_FORMAT_POLYLINE5},
+        {"polyline6", PATH_FORMAT_POLYLINE6},
+        {"delta32", PATH_FORMAT_DELTA32}
+    };
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        if (strcmp(name, formats[i].name) == 0) {
+            *out = formats[i].format;
+            return 0;
+        }
     }
+    return -1;
+}
 
-    printf("{\n");
-    printf("  \"status\": \"success\",\n");
-    printf("  \"total_distance\": %.2f,\n", res->total_distance);
-    
-    // Output Coordinates
-    printf("  \"path_coordinates\": [\n");
+// "path_coordinates": [[lat, lon], ...]
+static void json_coordinate_array(JsonBuf* b, const NavigationResult* res, const Graph* campus) {
+    json_buf_literal(b, "  \"path_coordinates\": [\n");
+    if (res->has_start) {
+        json_buf_literal(b, "    ");
+        json_coordinate(b, res->start_point[0], res->start_point[1]);
+        if (res->path_length > 0 || res->has_end) json_buf_literal(b, ",\n");
+    }
     for (int i = 0; i < res->path_length; i++) {
         int node_id = res->path_node_ids[i];
-        double lat = campus->nodes[node_id].lat;
-        double lon = campus->nodes[node_id].lon;
-        printf("    [%f, %f]", lat, lon);
-        if (i < res->path_length - 1) printf(",\n");
+        json_buf_literal(b, "    ");
+        json_coordinate(b, campus->lat[node_id], campus->lon[node_id]);
+        if (i < res->path_length - 1 || res->has_end) json_buf_literal(b, ",\n");
+    }
+    if (res->has_end) {
+        json_buf_literal(b, "    ");
+        json_coordinate(b, res->end_point[0], res->end_point[1]);
+    }
+    json_buf_literal(b, "\n  ],\n");
+}
+
+// "path_format" + encoded "path" (end points included) in place of path_coordinates
+static void json_encoded_path(JsonBuf* b, const NavigationResult* res, const Graph* campus, PathFormat format) {
+    int n = res->path_length + res->has_start + res->has_end;
+    double* lat = malloc(sizeof(double) * (n > 0 ? n : 1));
+    double* lon = malloc(sizeof(double) * (n > 0 ? n : 1));
+    int k = 0;
+    if (res->has_start) {
+        lat[k] = res->start_point[0];
+        lon[k++] = res->start_point[1];
+    }
+    for (int i = 0; i < res->path_length; i++) {
+        lat[k] = campus->lat[res->path_node_ids[i]];
+        lon[k++] = campus->lon[res->path_node_ids[i]];
+    }
+    if (res->has_end) {
+        lat[k] = res->end_point[0];
+        lon[k++] = res->end_point[1];
     }
-    printf("\n  ],\n");
+
+    if (format == PATH_FORMAT_DELTA32) {
+        json_buf_literal(b, "  \"path_format\": \"delta32\",\n  \"path\": ");
+        json_buf_delta32(b, lat, lon, n);
+    } else {
+        int precision = format == PATH_FORMAT_POLYLINE6 ? 6 : 5;
+        if (precision == 6) json_buf_literal(b, "  \"path_format\": \"polyline6\",\n  \"path\": ");
+        else json_buf_literal(b, "  \"path_format\": \"polyline5\",\n  \"path\": ");
+        json_buf_polyline(b, lat, lon, n, precision);
+    }
+    json_buf_literal(b, ",\n");
+    free(lat);
+    free(lon);
+}
+
+static const char* const counter_names[STAT_NUM_COUNTERS] = {
+    "nodes_settled", "edges_relaxed", "heap_pushes", "heap_pops", "alloc_bytes"
+};
+
+static const char* const phase_names[STAT_NUM_PHASES] = {
+    "search_ms", "instructions_ms", "serialize_ms"
+};
+
+// "name": milliseconds with microsecond resolution
+static void json_ms(JsonBuf* b, const char* name, double seconds) {
+    json_buf_string(b, name);
+    json_buf_literal(b, ": ");
+    json_buf_fixed(b, seconds * 1000.0, 3);
+}
+
+// One-line object: load time, phase times, then the counters
+static void json_stats_object(JsonBuf* b, const QueryStats* stats, double load_seconds) {
+    json_buf_char(b, '{');
+    json_ms(b, "load_ms", load_seconds);
+    for (int p = 0; p < STAT_NUM_PHASES; p++) {
+        json_buf_literal(b, ", ");
+        json_ms(b, phase_names[p], stats->seconds[p]);
+    }
+    for (int c = 0; c < STAT_NUM_COUNTERS; c++) {
+        json_buf_literal(b, ", ");
+        json_buf_string(b, counter_names[c]);
+        json_buf_literal(b, ": ");
+        json_buf_int(b, (long long)stats->counters[c]);
+    }
+    json_buf_char(b, '}');
+}
+
+void print_json_response(FILE* out, NavigationResult* res, Graph* campus, PathFormat format) {
+    if (res->status_code != 0) {
+        print_json_error(out, res->error_message ? res->error_message : "Unknown error");
+        return;
+    }
+
+    STATS_PHASE_BEGIN(serialize_start);
+    JsonBuf* b = json_thread_buffer();
+    // about 30 bytes per coordinate
+    json_buf_reserve(b, 256 + (size_t)(res->path_length + 2) * 32);
+
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"success\",\n");
+    json_buf_literal(b, "  \"total_distance\": ");
+    json_buf_fixed(b, res->total_distance, 2);
+    json_buf_literal(b, ",\n");
+
+    // Output Path (snapped end points around the graph nodes for coordinate queries)
+    if (format == PATH_FORMAT_COORDINATES) json_coordinate_array(b, res, campus);
+    else json_encoded_path(b, res, campus, format);
 
     // Output Via Indices
-    printf("  \"via_point_indices\": [");
+    json_buf_literal(b, "  \"via_point_indices\": [");
     if (res->via_indices && res->num_via_indices > 0) {
         for (int i = 0; i < res->num_via_indices; i++) {
-            printf("%d", res->via_indices[i]);
-            if (i < res->num_via_indices - 1) printf(", ");
+            json_buf_int(b, res->via_indices[i]);
+            if (i < res->num_via_indices - 1) json_buf_literal(b, ", ");
         }
     }
-    printf("],\n");
+    json_buf_literal(b, "],\n");
 
     // Output Instructions
-    printf("  \"instructions\": [\n");
+    json_buf_literal(b, "  \"instructions\": [\n");
     if (res->instructions && res->instruction_count > 0) {
         for (int i = 0; i < res->instruction_count; i++) {
-            // Escape quotes if necessary, simplified here
-            printf("    \"%s\"", res->instructions[i]);
-            if (i < res->instruction_count - 1) printf(",\n");
+            json_buf_literal(b, "    ");
+            json_buf_string(b, res->instructions[i]);
+            if (i < res->instruction_count - 1) json_buf_literal(b, ",\n");
         }
     } else {
-         printf("    \"Follow the path to your destination.\"\n");
+        json_buf_literal(b, "    \"Follow the path to your destination.\"\n");
     }
-    printf("\n  ]\n");
-    printf("}\n");
-}
\ No newline at end of file
+    STATS_PHASE_END(PHASE_SERIALIZE, serialize_start);
+
+    // Output Stats (serialize_ms covers the response up to here)
+    if (res->stats_mark) {
+        QueryStats stats;
+        stats_since(res->stats_mark, &stats);
+        json_buf_literal(b, "\n  ],\n");
+        json_buf_literal(b, "  \"stats\": ");
+        json_stats_object(b, &stats, stats_load_time());
+        json_buf_char(b, '\n');
+    } else {
+        json_buf_literal(b, "\n  ]\n");
+    }
+    json_buf_literal(b, "}\n");
+    json_buf_write(b, out);
+}
+
+void print_json_buildings(FILE* out, const BuildingMapping* mapping, const int* entries, int n) {
+    JsonBuf* b = json_thread_buffer();
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"success\",\n");
+    json_buf_literal(b, "  \"buildings\": [");
+    for (int i = 0; i < n; i++) {
+        json_buf_string(b, mapping->entries[entries[i]].name);
+        if (i < n - 1) json_buf_literal(b, ", ");
+    }
+    json_buf_literal(b, "]\n");
+    json_buf_literal(b, "}\n");
+    json_buf_write(b, out);
+}
+
+static void json_cache_object(JsonBuf* b, const char* name, const LruStats* stats, int last) {
+    json_buf_literal(b, "  ");
+    json_buf_string(b, name);
+    if (!stats) {
+        json_buf_literal(b, ": null");
+    } else {
+        json_buf_literal(b, ": {\"hits\": ");
+        json_buf_int(b, (long long)stats->hits);
+        json_buf_literal(b, ", \"misses\": ");
+        json_buf_int(b, (long long)stats->misses);
+        json_buf_literal(b, ", \"evictions\": ");
+        json_buf_int(b, (long long)stats->evictions);
+        json_buf_literal(b, ", \"entries\": ");
+        json_buf_int(b, (long long)stats->entries);
+        json_buf_literal(b, ", \"bytes\": ");
+        json_buf_int(b, (long long)stats->bytes);
+        json_buf_literal(b, ", \"max_bytes\": ");
+        json_buf_int(b, (long long)stats->max_bytes);
+        json_buf_char(b, '}');
+    }
+    if (last) json_buf_char(b, '\n');
+    else json_buf_literal(b, ",\n");
+}
+
+void print_json_cache_stats(FILE* out, const LruStats* responses, const LruStats* legs) {
+    JsonBuf* b = json_thread_buffer();
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"success\",\n");
+    json_cache_object(b, "response_cache", responses, 0);
+    json_cache_object(b, "leg_cache", legs, 1);
+    json_buf_literal(b, "}\n");
+    json_buf_write(b, out);
+}
+
+void print_json_stats_summary(FILE* out, const QueryStats* totals, unsigned long long requests,
+                              double load_seconds) {
+    QueryStats mean = *totals;
+    for (int p = 0; p < STAT_NUM_PHASES; p++) {
+        mean.seconds[p] = requests > 0 ? totals->seconds[p] / (double)requests : 0.0;
+    }
+
+    JsonBuf* b = json_thread_buffer();
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"success\",\n");
+    json_buf_literal(b, "  \"requests\": ");
+    json_buf_int(b, (long long)requests);
+    json_buf_literal(b, ",\n");
+    json_buf_literal(b, "  \"totals\": ");
+    json_stats_object(b, totals, load_seconds);
+    json_buf_literal(b, ",\n");
+    json_buf_literal(b, "  \"phase_means_ms\": {");
+    for (int p = 0; p < STAT_NUM_PHASES; p++) {
+        if (p > 0) json_buf_literal(b, ", ");
+        json_ms(b, phase_names[p], mean.seconds[p]);
+    }
+    json_buf_literal(b, "}\n");
+    json_buf_literal(b, "}\n");
+    json_buf_write(b, out);
+}
+
+void print_json_matrix(FILE* out, const char** names, int n, const double* dist) {
+    STATS_PHASE_BEGIN(serialize_start);
+    JsonBuf* b = json_thread_buffer();
+    json_buf_reserve(b, 256 + (size_t)n * n * 12);
+    json_buf_literal(b, "{\n");
+    json_buf_literal(b, "  \"status\": \"success\",\n");
+
+    json_buf_literal(b, "  \"buildings\": [");
+    for (int i = 0; i < n; i++) {
+        json_buf_string(b, names[i]);
+        if (i < n - 1) json_buf_literal(b, ", ");
+    }
+    json_buf_literal(b, "],\n");
+
+    json_buf_literal(b, "  \"distances\": [\n");
+    for (int i = 0; i < n; i++) {
+        json_buf_literal(b, "    [");
+        for (int j = 0; j < n; j++) {
+            double d = dist[(size_t)i * n + j];
+            if (d == DBL_MAX) json_buf_literal(b, "null");
+            else json_buf_fixed(b, d, 2);
+            if (j < n - 1) json_buf_literal(b, ", ");
+        }
+        json_buf_char(b, ']');
+        if (i < n - 1) json_buf_literal(b, ",\n");
+    }
+    json_buf_literal(b, "\n  ]\n");
+    json_buf_literal(b, "}\n");
+    STATS_PHASE_END(PHASE_SERIALIZE, serialize_start);
+    json_buf_write(b, out);
+}
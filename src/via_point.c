@@ -1,16 +1,14 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <float.h>
-#include <omp.h>
+#include <string.h>
 #include "via_point.h"
 #include "astar.h"
+#include "matrix.h"
+#include "cache.h"
+#include "stats.h"
+#include "logging.h"
 
-// color 
-#define color_direct   "\033[34m"  
-#define color_parallel "\033[33m"  
-#define color_success  "\033[32m"  
-#define color_error    "\033[31m"  
-#define color_reset    "\033[0m"   
 /*
 * split into num_via+1 segments
 * compute each segment in parallel using A* algorithm
@@ -24,12 +22,14 @@
 */
 
 double astar_via_points(Graph* graph,int start_id,int goal_id,
-int*via_ids,int num_via,int**out_path, int* out_len)
+int*via_ids,int num_via,int**out_path, int* out_len, PathSearchFn search)
 {
+    if (!search) search = astar;
+
     // no via points use direct A*
     if (num_via == 0) {
-        printf(color_direct"direct route \n" color_reset);
-        return astar(graph, start_id, goal_id, out_path, out_len);
+        LOG_DEBUG("via route: no via points, direct search");
+        return cached_search(search, graph, start_id, goal_id, out_path, out_len);
     }
 
     int num_segments = num_via + 1;
@@ -37,7 +37,7 @@ int*via_ids,int num_via,int**out_path, int* out_len)
     int* segment_lens = calloc(num_segments, sizeof(int));
     double* segment_dists = calloc(num_segments, sizeof(double));
     if (!segment_paths || !segment_lens || !segment_dists) {
-        printf(color_error"memory allocation failed\n" color_reset);
+        LOG_ERROR("via route: memory allocation failed");
         free(segment_paths);
         free(segment_lens);
         free(segment_dists);
@@ -50,34 +50,30 @@ int*via_ids,int num_via,int**out_path, int* out_len)
         segment_dists[i] = DBL_MAX;
     }
 
+    STATS_CALLER(caller);
     #pragma omp parallel for num_threads(num_segments)
     for (int i = 0; i < num_segments; i++) {
+        STATS_CREDIT_BEGIN(credit, caller);
         int from_id = (i == 0) ? start_id : via_ids[i - 1];
         int to_id = (i == num_segments - 1) ? goal_id : via_ids[i];
 
-        int thread_id = omp_get_thread_num();
-        printf(color_parallel"[Thread %d] Segment %d: %d->%d\n" color_reset,
-               thread_id, i, from_id, to_id);
-
-        double dist = astar(graph, from_id, to_id, &segment_paths[i], &segment_lens[i]);
+        double dist = cached_search(search, graph, from_id, to_id, &segment_paths[i], &segment_lens[i]);
         segment_dists[i] = dist;
 
         if (dist != DBL_MAX && segment_paths[i]) {
-            printf(color_success"[Thread %d] ok Segment %d complete: %.2f m\n" color_reset,
-                   thread_id, i, dist);
+            LOG_DEBUG("via route: segment %d (%d -> %d) %.2f m", i, from_id, to_id, dist);
         } else {
-            printf(color_error"[Thread %d] sad Segment %d failed: No path\n" color_reset,
-                   thread_id, i);
+            LOG_WARN("via route: segment %d (%d -> %d) has no path", i, from_id, to_id);
         }
+        STATS_CREDIT_END(credit);
     }
 
-    printf(color_parallel"parallel finished! please check \n" color_reset);
 
     int all_success = 1;
     double total_distance = 0.0;
     for (int i = 0; i < num_segments; i++) {
         if (segment_dists[i] == DBL_MAX || segment_paths[i] == NULL) {
-            printf(color_error"segment %d failed\n" color_reset, i);
+            LOG_WARN("via route: segment %d failed, no route", i);
             all_success = 0;
             break;
         }
@@ -85,7 +81,6 @@ int*via_ids,int num_via,int**out_path, int* out_len)
     }
 
     if (!all_success) {
-        printf(color_error"clean \n" color_reset);
         for (int i = 0; i < num_segments; i++) {
             free(segment_paths[i]);
         }
@@ -97,7 +92,6 @@ int*via_ids,int num_via,int**out_path, int* out_len)
         return DBL_MAX;
     }
 
-    printf(color_success" merge segment\n" color_reset);
     int total_len = 0;
     for (int i = 0; i < num_segments; i++) {
         total_len += segment_lens[i];
@@ -107,8 +101,9 @@ int*via_ids,int num_via,int**out_path, int* out_len)
     }
 
     int* merged_path = malloc(sizeof(int) * total_len);
+    STAT_ADD(STAT_ALLOC_BYTES, sizeof(int) * total_len);
     if (!merged_path) {
-        printf(color_error"memory allocation failed when merging\n" color_reset);
+        LOG_ERROR("via route: memory allocation failed when merging");
         for (int i = 0; i < num_segments; i++) {
             free(segment_paths[i]);
         }
@@ -136,7 +131,187 @@ int*via_ids,int num_via,int**out_path, int* out_len)
     *out_len = total_len;
     *out_path = merged_path;
 
-    printf(color_success"total distance:%.2f \n" color_reset, total_distance);
-    printf(color_success"total nodes %d \n" color_reset, total_len);
+    LOG_INFO("via route: %d segments, %.2f m, %d nodes", num_segments, total_distance, total_len);
     return total_distance;
 }
+
+/******************************************************
+ * Via-point ordering (cheapest insertion + 2-opt)
+ ******************************************************/
+
+// Unreachable legs stay comparable so the cheapest feasible order still wins
+#define VIA_UNREACHABLE_COST 1e9
+
+/*
+* matrix rows: start, via 0..n-1     (sources)
+* matrix cols: via 0..n-1, goal      (targets)
+* route: via indices between the fixed start and goal
+*/
+static double via_leg(const double* dist, int n, int from, int to) {
+    // from / to: -1 = start / goal, otherwise a via index
+    double d = dist[(from + 1) * (n + 1) + (to < 0 ? n : to)];
+    return d == DBL_MAX ? VIA_UNREACHABLE_COST : d;
+}
+
+static double via_route_cost(const double* dist, int n, const int* route) {
+    double cost = via_leg(dist, n, -1, route[0]);
+    for (int i = 0; i + 1 < n; i++) cost += via_leg(dist, n, route[i], route[i + 1]);
+    return cost + via_leg(dist, n, route[n - 1], -1);
+}
+
+void order_via_points(Graph* graph, int start_id, int goal_id, int* via_ids, int num_via) {
+    if (num_via < 2) return;
+    int n = num_via;
+
+    int* sources = malloc(sizeof(int) * (n + 1));
+    int* targets = malloc(sizeof(int) * (n + 1));
+    sources[0] = start_id;
+    for (int i = 0; i < n; i++) {
+        sources[i + 1] = via_ids[i];
+        targets[i] = via_ids[i];
+    }
+    targets[n] = goal_id;
+    double* dist = distance_matrix(graph, sources, n + 1, targets, n + 1);
+
+    // 1. cheapest insertion: repeatedly insert the via point and position that add the least
+    int* route = malloc(sizeof(int) * n);
+    char* placed = calloc(n, sizeof(char));
+    for (int len = 0; len < n; len++) {
+        int best_v = -1, best_pos = 0;
+        double best_add = DBL_MAX;
+        for (int v = 0; v < n; v++) {
+            if (placed[v]) continue;
+            for (int pos = 0; pos <= len; pos++) {
+                int prev = pos == 0 ? -1 : route[pos - 1];
+                int next = pos == len ? -1 : route[pos];
+                double add = via_leg(dist, n, prev, v) + via_leg(dist, n, v, next)
+                           - via_leg(dist, n, prev, next);
+                if (add < best_add) {
+                    best_add = add;
+                    best_v = v;
+                    best_pos = pos;
+                }
+            }
+        }
+        memmove(route + best_pos + 1, route + best_pos, sizeof(int) * (len - best_pos));
+        route[best_pos] = best_v;
+        placed[best_v] = 1;
+    }
+
+    // 2. 2-opt: reverse route[i..j] while it helps (legs may be one-way, so price whole routes)
+    double cost = via_route_cost(dist, n, route);
+    int improved = 1;
+    while (improved) {
+        improved = 0;
+        for (int i = 0; i < n - 1; i++) {
+            for (int j = i + 1; j < n; j++) {
+                for (int a = i, b = j; a < b; a++, b--) {
+                    int t = route[a]; route[a] = route[b]; route[b] = t;
+                }
+                double c = via_route_cost(dist, n, route);
+                if (c < cost - 1e-9) {
+                    cost = c;
+                    improved = 1;
+                } else {
+                    for (int a = i, b = j; a < b; a++, b--) {
+                        int t = route[a]; route[a] = route[b]; route[b] = t;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < n; i++) route[i] = sources[route[i] + 1];
+    memcpy(via_ids, route, sizeof(int) * n);
+
+    free(placed);
+    free(route);
+    free(dist);
+    free(targets);
+    free(sources);
+}
+
+/******************************************************
+ * Routing between snapped coordinates
+ ******************************************************/
+
+// Cheapest edge u -> v, DBL_MAX if there is none
+static double edge_weight(const Graph* g, int u, int v) {
+    double w = DBL_MAX;
+    for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+        if (g->targets[e] == v && g->weights[e] < w) w = g->weights[e];
+    }
+    return w;
+}
+
+double route_between_snaps(Graph* graph, const EdgeSnap* from, const EdgeSnap* to,
+                           PathSearchFn search, int** out_path, int* out_len) {
+    if (!search) search = astar;
+    *out_path = NULL;
+    *out_len = 0;
+
+    // exits of the source: (node, cost from the snapped point)
+    int exit_nodes[2], num_exits = 0;
+    double exit_cost[2];
+    double fw = edge_weight(graph, from->from, from->to);
+    double bw = edge_weight(graph, from->to, from->from);
+    if (fw != DBL_MAX) {
+        exit_nodes[num_exits] = from->to;
+        exit_cost[num_exits++] = (1 - from->t) * fw;
+    }
+    if (bw != DBL_MAX) {
+        exit_nodes[num_exits] = from->from;
+        exit_cost[num_exits++] = from->t * bw;
+    }
+
+    // entries of the target: (node, cost to the snapped point)
+    int entry_nodes[2], num_entries = 0;
+    double entry_cost[2];
+    double tfw = edge_weight(graph, to->from, to->to);
+    double tbw = edge_weight(graph, to->to, to->from);
+    if (tfw != DBL_MAX) {
+        entry_nodes[num_entries] = to->from;
+        entry_cost[num_entries++] = to->t * tfw;
+    }
+    if (tbw != DBL_MAX) {
+        entry_nodes[num_entries] = to->to;
+        entry_cost[num_entries++] = (1 - to->t) * tbw;
+    }
+
+    // both points on one segment: drive along it if the direction allows
+    double best = DBL_MAX;
+    int best_exit = -1, best_entry = -1;
+    if (from->from == to->from && from->to == to->to) {
+        if (fw != DBL_MAX && from->t <= to->t) best = (to->t - from->t) * fw;
+        if (bw != DBL_MAX && from->t >= to->t && (from->t - to->t) * bw < best) best = (from->t - to->t) * bw;
+    }
+
+    if (num_exits > 0 && num_entries > 0) {
+        double* dist = distance_matrix(graph, exit_nodes, num_exits, entry_nodes, num_entries);
+        for (int i = 0; i < num_exits; i++) {
+            for (int j = 0; j < num_entries; j++) {
+                double d = dist[i * num_entries + j];
+                if (d == DBL_MAX) continue;
+                d += exit_cost[i] + entry_cost[j];
+                if (d < best) {
+                    best = d;
+                    best_exit = i;
+                    best_entry = j;
+                }
+            }
+        }
+        free(dist);
+    }
+
+    if (best == DBL_MAX || best_exit < 0) return best;
+
+    int a = exit_nodes[best_exit], b = entry_nodes[best_entry];
+    if (a == b) {
+        *out_path = malloc(sizeof(int));
+        (*out_path)[0] = a;
+        *out_len = 1;
+        return best;
+    }
+    if (cached_search(search, graph, a, b, out_path, out_len) == DBL_MAX) return DBL_MAX;
+    return best;
+}
@@ -0,0 +1,109 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "json.h"
+
+/*
+* json_buf_fixed against snprintf("%.*f"): random magnitudes, exact and
+* near ties, negative zero, values past the 1e15 fast-path limit
+* usage: test_json [seed]
+*/
+
+#define RANDOM_VALUES 200000
+#define TIE_VALUES 20000
+
+static int checked = 0;
+static int failures = 0;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Uniform in [0, 1)
+static double random_unit(void) {
+    return (double)(next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void check(double v, int decimals) {
+    char expected[512];
+    snprintf(expected, sizeof(expected), "%.*f", decimals, v);
+
+    JsonBuf* b = json_thread_buffer();
+    json_buf_fixed(b, v, decimals);
+    checked++;
+    if (b->len != strlen(expected) || memcmp(b->data, expected, b->len) != 0) {
+        if (failures < 20) {
+            fprintf(stderr, "\033[31m:( json_buf_fixed(%.17g, %d) = \"%.*s\", snprintf = \"%s\"\033[0m\n",
+                    v, decimals, (int)b->len, b->data, expected);
+        }
+        failures++;
+    }
+}
+
+static void check_all_decimals(double v) {
+    for (int d = 0; d <= 9; d++) check(v, d);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) rng_state = strtoull(argv[1], NULL, 10) | 1;
+
+    // random magnitudes from 1e-12 to 1e18, both signs
+    for (int i = 0; i < RANDOM_VALUES; i++) {
+        double v = pow(10.0, -12.0 + 30.0 * random_unit()) * (next_random() & 1 ? -1.0 : 1.0);
+        check(v, (int)(next_random() % 10));
+    }
+
+    // coordinates and distances as the responses print them
+    for (int i = 0; i < RANDOM_VALUES / 4; i++) {
+        check(-180.0 + 360.0 * random_unit(), 6);
+        check(50000.0 * random_unit(), 2);
+        check(1e-3 * random_unit(), 3);
+    }
+
+    // ties: (k + 0.5) / 10^d, exact in binary or not, and their neighbours
+    for (int i = 0; i < TIE_VALUES; i++) {
+        int d = (int)(next_random() % 10);
+        double k = (double)(next_random() % 1000000);
+        double v = (k + 0.5) / pow(10.0, d);
+        check(v, d);
+        check(-v, d);
+        check(nextafter(v, 0.0), d);
+        check(nextafter(v, DBL_MAX), d);
+    }
+    static const double ties[] = {0.5, 1.5, 2.5, 0.125, 0.375, 1.005, 2.675, 1.0005, 0.045, 1e-10};
+    for (size_t i = 0; i < sizeof(ties) / sizeof(ties[0]); i++) {
+        check_all_decimals(ties[i]);
+        check_all_decimals(-ties[i]);
+    }
+
+    // zeros, negative zero and negative values that round to zero
+    static const double zeros[] = {0.0, -0.0, -1e-12, -0.0004, -0.4, 4e-10, DBL_MIN, -DBL_MIN};
+    for (size_t i = 0; i < sizeof(zeros) / sizeof(zeros[0]); i++) check_all_decimals(zeros[i]);
+
+    // around and past the fast-path limit (scaled value >= 1e15)
+    static const double large[] = {999999.9999999, 1e15 - 1, 1e15, 1e15 + 0.5, 9.87654321e15,
+                                   1e16, 4503599627370496.5, 9007199254740993.0, 1.8446744073709552e19,
+                                   1e22, 1.5e300, DBL_MAX};
+    for (size_t i = 0; i < sizeof(large) / sizeof(large[0]); i++) {
+        check_all_decimals(large[i]);
+        check_all_decimals(-large[i]);
+    }
+    check_all_decimals(INFINITY);
+    check_all_decimals(-INFINITY);
+    check_all_decimals(NAN);
+
+    if (failures > 0) {
+        fprintf(stderr, "\033[31m:( json_buf_fixed: %d of %d values differ from snprintf\033[0m\n", failures, checked);
+        return 1;
+    }
+    fprintf(stderr, "\033[32m:) json_buf_fixed matches snprintf on %d values\033[0m\n", checked);
+    return 0;
+}
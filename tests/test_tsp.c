@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <stdint.h>
+#include "tsp.h"
+
+/*
+* tsp_held_karp against every permutation for N <= 8 in each mode (open,
+* fixed start, fixed start and end, round trip), on random asymmetric
+* matrices: real-valued, small integers (many equal-length orders) and
+* with unreachable legs
+* usage: test_tsp [seed]
+*/
+
+#define MAX_POINTS 8
+#define INSTANCES_PER_SIZE 40
+#define UNREACHABLE_LIMIT 1e14 // what find_optimal_multi_building_route treats as no route
+
+static const char* const mode_names[] = {"open", "start", "start-end", "round-trip"};
+
+static int checked = 0;
+static int failures = 0;
+
+static uint64_t rng_state = 88172645463325252ULL;
+
+static uint64_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+// Fixed points of a mode, as find_optimal_multi_building_route picks them
+static void mode_points(int mode, int N, int* first, int* last) {
+    *first = mode == TSP_MODE_OPEN ? -1 : 0;
+    *last = mode == TSP_MODE_FIXED_ENDS ? N - 1 : (mode == TSP_MODE_ROUND_TRIP ? 0 : -1);
+}
+
+// Length of a visiting order, INFINITY if it breaks a fixed point or uses an unreachable leg
+static double order_length(const double* dist, int N, int first, int last, const int* order) {
+    int closed = first >= 0 && first == last;
+    if (first >= 0 && order[0] != first) return INFINITY;
+    if (last >= 0 && !closed && order[N - 1] != last) return INFINITY;
+
+    double length = 0.0;
+    int legs = closed ? N : N - 1;
+    for (int i = 0; i < legs; i++) {
+        double d = dist[order[i] * N + order[(i + 1) % N]];
+        if (d == DBL_MAX) return INFINITY;
+        length += d;
+    }
+    return length;
+}
+
+// Shortest order_length over all permutations of 0..N-1 (Heap's algorithm)
+static double brute_force(const double* dist, int N, int first, int last) {
+    int perm[MAX_POINTS], c[MAX_POINTS] = {0};
+    for (int i = 0; i < N; i++) perm[i] = i;
+
+    double best = order_length(dist, N, first, last, perm);
+    int i = 1;
+    while (i < N) {
+        if (c[i] < i) {
+            int k = i % 2 == 0 ? 0 : c[i];
+            int tmp = perm[k];
+            perm[k] = perm[i];
+            perm[i] = tmp;
+            double length = order_length(dist, N, first, last, perm);
+            if (length < best) best = length;
+            c[i]++;
+            i = 1;
+        } else {
+            c[i] = 0;
+            i++;
+        }
+    }
+    return best;
+}
+
+// Each point exactly once
+static int is_permutation(const int* order, int N) {
+    int seen[MAX_POINTS] = {0};
+    for (int i = 0; i < N; i++) {
+        if (order[i] < 0 || order[i] >= N || seen[order[i]]++) return 0;
+    }
+    return 1;
+}
+
+static void fail(const char* what, int N, int mode, double expected, double got) {
+    if (failures < 20) {
+        fprintf(stderr, "\033[31m:( N = %d, %s: %s (brute force %.6f, Held-Karp %.6f)\033[0m\n",
+                N, mode_names[mode], what, expected, got);
+    }
+    failures++;
+}
+
+static void check(const double* dist, int N, int mode) {
+    int first, last;
+    mode_points(mode, N, &first, &last);
+
+    int order[MAX_POINTS];
+    for (int i = 0; i < N; i++) order[i] = -1;
+    double got = tsp_held_karp(dist, N, first, last, order);
+    double expected = brute_force(dist, N, first, last);
+    checked++;
+
+    if (isinf(expected)) {
+        if (got < UNREACHABLE_LIMIT) fail("found a route where none exists", N, mode, expected, got);
+        return;
+    }
+    if (fabs(got - expected) > 1e-9 * (1.0 + expected)) {
+        fail("length differs", N, mode, expected, got);
+        return;
+    }
+    if (!is_permutation(order, N)) {
+        fail("order is not a permutation", N, mode, expected, got);
+        return;
+    }
+    double walked = order_length(dist, N, first, last, order);
+    if (fabs(walked - got) > 1e-9 * (1.0 + got)) fail("order does not have the returned length", N, mode, walked, got);
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1) rng_state = strtoull(argv[1], NULL, 10) | 1;
+
+    double dist[MAX_POINTS * MAX_POINTS];
+    for (int N = 1; N <= MAX_POINTS; N++) {
+        for (int instance = 0; instance < INSTANCES_PER_SIZE; instance++) {
+            int kind = instance % 3; // 0: real-valued, 1: small integers, 2: with unreachable legs
+            for (int i = 0; i < N; i++) {
+                for (int j = 0; j < N; j++) {
+                    double d = kind == 1 ? (double)(next_random() % 4)
+                                         : (double)(next_random() % 1000000) / 1000.0;
+                    if (kind == 2 && next_random() % 4 == 0) d = DBL_MAX;
+                    dist[i * N + j] = i == j ? 0.0 : d;
+                }
+            }
+            for (int mode = TSP_MODE_OPEN; mode <= TSP_MODE_ROUND_TRIP; mode++) {
+                if (mode == TSP_MODE_FIXED_ENDS && N < 2) continue;
+                check(dist, N, mode);
+            }
+        }
+    }
+
+    if (failures > 0) {
+        fprintf(stderr, "\033[31m:( tsp_held_karp: %d of %d instances differ from brute force\033[0m\n", failures, checked);
+        return 1;
+    }
+    fprintf(stderr, "\033[32m:) tsp_held_karp matches brute force on %d instances (N <= %d, all modes)\033[0m\n",
+            checked, MAX_POINTS);
+    return 0;
+}
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include <stdint.h>
+#include <omp.h>
+#include "graph.h"
+#include "astar.h"
+#include "via_point.h"
+#include "tsp.h"
+#include "handlers.h"
+#include "search_context.h"
+#include "json.h"
+#include "logging.h"
+
+/*
+* routing benchmark on reproducible synthetic workloads
+* usage (from src/, like bin/main): bench [--queries=<n>] [--seed=<s>] [--tsp-runs=<n>] [--out=<file>]
+*
+* workloads, all drawn from one seeded generator so runs are comparable:
+*   pairs/<engine>    uniform random node pairs, once per search engine
+*   buildings         random building-to-building pairs (astar)
+*   via               start, 1-4 via buildings, goal (astar_via_points)
+*   tsp/<k>           k = 5..18 distinct buildings (find_optimal_multi_building_route)
+* per workload: latency percentiles, throughput and nodes settled per query, as JSON
+*/
+
+#define BENCH_DEFAULT_QUERIES 1000
+#define BENCH_DEFAULT_TSP_RUNS 3
+#define BENCH_WARMUP 10
+#define TSP_MIN_SIZE 5
+#define TSP_MAX_SIZE 18
+#define VIA_MAX 4
+
+static const char* engines[] = {"astar", "bidir", "alt", "ch"};
+
+/******************************************************
+ * Random numbers (splitmix64, same sequence on every platform)
+ ******************************************************/
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static int rng_below(int n) {
+    return (int)(rng_next() % (uint64_t)n);
+}
+
+// k distinct values of 0..n-1 (partial Fisher-Yates over a scratch permutation)
+static void rng_distinct(int* perm, int n, int* out, int k) {
+    for (int i = 0; i < k; i++) {
+        int j = i + rng_below(n - i);
+        int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+        out[i] = perm[i];
+    }
+}
+
+/******************************************************
+ * Measurements
+ ******************************************************/
+
+typedef struct {
+    const char* name;
+    int count;
+    int found;                // queries that returned a route
+    double total_time;        // seconds
+    double* latency;          // seconds, per query
+    double* settled;          // nodes settled, per query
+} Workload;
+
+static void workload_init(Workload* w, const char* name, int capacity) {
+    w->name = name;
+    w->count = 0;
+    w->found = 0;
+    w->total_time = 0.0;
+    w->latency = malloc(sizeof(double) * capacity);
+    w->settled = malloc(sizeof(double) * capacity);
+}
+
+static void workload_record(Workload* w, double seconds, unsigned long long settled, int found) {
+    w->latency[w->count] = seconds;
+    w->settled[w->count] = (double)settled;
+    w->count++;
+    w->found += found;
+    w->total_time += seconds;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted values
+static double percentile(const double* sorted, int n, double p) {
+    if (n == 0) return 0.0;
+    int rank = (int)(p / 100.0 * n + 0.999999);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static double mean(const double* values, int n) {
+    double sum = 0.0;
+    for (int i = 0; i < n; i++) sum += values[i];
+    return n > 0 ? sum / n : 0.0;
+}
+
+static void json_key(JsonBuf* b, const char* key) {
+    json_buf_string(b, key);
+    json_buf_literal(b, ": ");
+}
+
+static void workload_json(JsonBuf* b, Workload* w) {
+    qsort(w->latency, w->count, sizeof(double), compare_double);
+    qsort(w->settled, w->count, sizeof(double), compare_double);
+    int n = w->count;
+
+    json_buf_literal(b, "    {");
+    json_key(b, "name");
+    json_buf_string(b, w->name);
+    json_buf_literal(b, ", ");
+    json_key(b, "queries");
+    json_buf_int(b, n);
+    json_buf_literal(b, ", ");
+    json_key(b, "found");
+    json_buf_int(b, w->found);
+    json_buf_literal(b, ", ");
+    json_key(b, "throughput_qps");
+    json_buf_fixed(b, w->total_time > 0 ? n / w->total_time : 0.0, 1);
+    json_buf_literal(b, ",\n      ");
+
+    json_key(b, "latency_us");
+    json_buf_literal(b, "{\"p50\": ");
+    json_buf_fixed(b, percentile(w->latency, n, 50) * 1e6, 1);
+    json_buf_literal(b, ", \"p95\": ");
+    json_buf_fixed(b, percentile(w->latency, n, 95) * 1e6, 1);
+    json_buf_literal(b, ", \"p99\": ");
+    json_buf_fixed(b, percentile(w->latency, n, 99) * 1e6, 1);
+    json_buf_literal(b, ", \"mean\": ");
+    json_buf_fixed(b, mean(w->latency, n) * 1e6, 1);
+    json_buf_literal(b, ", \"max\": ");
+    json_buf_fixed(b, n > 0 ? w->latency[n - 1] * 1e6 : 0.0, 1);
+    json_buf_literal(b, "},\n      ");
+
+    json_key(b, "settled");
+    json_buf_literal(b, "{\"p50\": ");
+    json_buf_fixed(b, percentile(w->settled, n, 50), 0);
+    json_buf_literal(b, ", \"p95\": ");
+    json_buf_fixed(b, percentile(w->settled, n, 95), 0);
+    json_buf_literal(b, ", \"mean\": ");
+    json_buf_fixed(b, mean(w->settled, n), 1);
+    json_buf_literal(b, "}}");
+
+    free(w->latency);
+    free(w->settled);
+}
+
+/******************************************************
+ * Workloads
+ ******************************************************/
+
+static void bench_pairs(Workload* w, Graph* g, PathSearchFn search, const int* pairs, int count) {
+    for (int i = 0; i < BENCH_WARMUP && i < count; i++) {
+        int* path = NULL;
+        int len = 0;
+        search(g, pairs[2 * i], pairs[2 * i + 1], &path, &len);
+        free(path);
+    }
+    for (int i = 0; i < count; i++) {
+        int* path = NULL;
+        int len = 0;
+        unsigned long long settled = search_settled_total();
+        double t = omp_get_wtime();
+        double d = search(g, pairs[2 * i], pairs[2 * i + 1], &path, &len);
+        t = omp_get_wtime() - t;
+        workload_record(w, t, search_settled_total() - settled, d < DBL_MAX && path != NULL);
+        free(path);
+    }
+}
+
+static void bench_via(Workload* w, Graph* g, const BuildingMapping* m, int* perm, int count) {
+    int stops[VIA_MAX + 2];
+    for (int i = 0; i < count; i++) {
+        int num_via = 1 + rng_below(VIA_MAX);
+        rng_distinct(perm, m->count, stops, num_via + 2);
+        for (int k = 0; k < num_via + 2; k++) stops[k] = m->entries[stops[k]].node_id;
+
+        int* path = NULL;
+        int len = 0;
+        unsigned long long settled = search_settled_total();
+        double t = omp_get_wtime();
+        double d = astar_via_points(g, stops[0], stops[num_via + 1], stops + 1, num_via, &path, &len, astar);
+        t = omp_get_wtime() - t;
+        workload_record(w, t, search_settled_total() - settled, d < DBL_MAX && path != NULL);
+        free(path);
+    }
+}
+
+static void bench_tsp(Workload* w, Graph* g, BuildingMapping* m, int* perm, int size, int runs) {
+    int picks[TSP_MAX_SIZE];
+    const char* names[TSP_MAX_SIZE];
+    for (int r = 0; r < runs; r++) {
+        rng_distinct(perm, m->count, picks, size);
+        for (int k = 0; k < size; k++) names[k] = m->entries[picks[k]].name;
+
+        double dist = 0.0;
+        int* path = NULL;
+        int len = 0;
+        unsigned long long settled = search_settled_total();
+        double t = omp_get_wtime();
+        int status = find_optimal_multi_building_route(g, m, names, size, astar, NULL,
+                                                       &dist, &path, &len, NULL);
+        t = omp_get_wtime() - t;
+        workload_record(w, t, search_settled_total() - settled, status == 0);
+        free(path);
+    }
+}
+
+static int parse_count(const char* text, int* out) {
+    char* end;
+    long v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v <= 0 || v > 100000000) return -1;
+    *out = (int)v;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    int queries = BENCH_DEFAULT_QUERIES;
+    int tsp_runs = BENCH_DEFAULT_TSP_RUNS;
+    unsigned long long seed = 1;
+    const char* out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        int bad = 0;
+        if (strncmp(argv[i], "--queries=", 10) == 0) bad = parse_count(argv[i] + 10, &queries);
+        else if (strncmp(argv[i], "--tsp-runs=", 11) == 0) bad = parse_count(argv[i] + 11, &tsp_runs);
+        else if (strncmp(argv[i], "--seed=", 7) == 0) seed = strtoull(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--out=", 6) == 0) out_path = argv[i] + 6;
+        else bad = 1;
+        if (bad) {
+            fprintf(stderr, "Usage: %s [--queries=<n>] [--seed=<s>] [--tsp-runs=<n>] [--out=<file>]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // per-query info records would be printed inside the timed loops
+    log_runtime_level = LOG_LEVEL_WARN;
+
+    Graph* campus = NULL;
+    BuildingMapping* mapping = NULL;
+    if (!load_campus_resources(&campus, &mapping)) {
+        fprintf(stderr, "\033[31m:( Failed to load map data (run from src/)\033[0m\n");
+        return 1;
+    }
+    if (mapping->count < TSP_MAX_SIZE) {
+        fprintf(stderr, "\033[31m:( Need at least %d buildings, found %d\033[0m\n", TSP_MAX_SIZE, mapping->count);
+        free_campus_resources(campus, mapping);
+        return 1;
+    }
+
+    int num_engines = (int)(sizeof(engines) / sizeof(engines[0]));
+    int num_workloads = num_engines + 2 + (TSP_MAX_SIZE - TSP_MIN_SIZE + 1);
+    Workload* workloads = malloc(sizeof(Workload) * num_workloads);
+    int* perm = malloc(sizeof(int) * mapping->count);
+    for (int i = 0; i < mapping->count; i++) perm[i] = i;
+    int w = 0;
+
+    // Same node pairs for every engine
+    rng_state = seed;
+    int* pairs = malloc(sizeof(int) * 2 * queries);
+    for (int i = 0; i < 2 * queries; i++) pairs[i] = rng_below(campus->num_nodes);
+    static char pair_names[sizeof(engines) / sizeof(engines[0])][32];
+    for (int e = 0; e < num_engines; e++) {
+        snprintf(pair_names[e], sizeof(pair_names[e]), "pairs/%s", engines[e]);
+        fprintf(stderr, "[BENCH] %s\n", pair_names[e]);
+        workload_init(&workloads[w], pair_names[e], queries);
+        bench_pairs(&workloads[w++], campus, find_search_algorithm(engines[e]), pairs, queries);
+    }
+
+    fprintf(stderr, "[BENCH] buildings\n");
+    for (int i = 0; i < queries; i++) {
+        int two[2];
+        rng_distinct(perm, mapping->count, two, 2);
+        pairs[2 * i] = mapping->entries[two[0]].node_id;
+        pairs[2 * i + 1] = mapping->entries[two[1]].node_id;
+    }
+    workload_init(&workloads[w], "buildings", queries);
+    bench_pairs(&workloads[w++], campus, astar, pairs, queries);
+    free(pairs);
+
+    int via_queries = queries / 4 > 0 ? queries / 4 : 1;
+    fprintf(stderr, "[BENCH] via\n");
+    workload_init(&workloads[w], "via", via_queries);
+    bench_via(&workloads[w++], campus, mapping, perm, via_queries);
+
+    static char tsp_names[TSP_MAX_SIZE + 1][16];
+    for (int k = TSP_MIN_SIZE; k <= TSP_MAX_SIZE; k++) {
+        snprintf(tsp_names[k], sizeof(tsp_names[k]), "tsp/%d", k);
+        fprintf(stderr, "[BENCH] %s\n", tsp_names[k]);
+        workload_init(&workloads[w], tsp_names[k], tsp_runs);
+        bench_tsp(&workloads[w++], campus, mapping, perm, k, tsp_runs);
+    }
+
+    JsonBuf* b = json_thread_buffer();
+    json_buf_literal(b, "{\n  \"seed\": ");
+    json_buf_int(b, (long long)seed);
+    json_buf_literal(b, ",\n  \"nodes\": ");
+    json_buf_int(b, campus->num_nodes);
+    json_buf_literal(b, ",\n  \"edges\": ");
+    json_buf_int(b, campus->num_edges);
+    json_buf_literal(b, ",\n  \"buildings\": ");
+    json_buf_int(b, mapping->count);
+    json_buf_literal(b, ",\n  \"threads\": ");
+    json_buf_int(b, omp_get_max_threads());
+    json_buf_literal(b, ",\n  \"workloads\": [\n");
+    for (int i = 0; i < w; i++) {
+        workload_json(b, &workloads[i]);
+        if (i < w - 1) json_buf_literal(b, ",\n");
+    }
+    json_buf_literal(b, "\n  ]\n}\n");
+
+    int status = 0;
+    FILE* out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out || json_buf_write(b, out) != 0) {
+        fprintf(stderr, "\033[31m:( Cannot write '%s'\033[0m\n", out_path ? out_path : "stdout");
+        status = 1;
+    }
+    if (out && out != stdout) fclose(out);
+    if (status == 0 && out_path) fprintf(stderr, "\033[32m:) Wrote %s\033[0m\n", out_path);
+
+    free(workloads);
+    free(perm);
+    free_campus_resources(campus, mapping);
+    return status;
+}
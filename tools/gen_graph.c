@@ -0,0 +1,411 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#include <float.h>
+#include "graph.h"
+#include "spatial.h"
+#include "utils.h"
+
+/*
+* synthetic graph generator for scaling tests (offline, seeded)
+* usage: gen_graph <grid|geometric|tiled> <nodes> <out_dir> [--seed=<s>] [--oneway=<p>]
+*                  [--buildings=<n>] [--campus=<dir>]
+* writes out_dir/adj_list.csv, node_coordinates.csv and building_mapping.csv in the
+* same format as data/, so load_graph / build_snapshot take them unchanged
+*
+* grid       perturbed square grid, a few streets missing
+* geometric  random points, each joined to its nearest neighbours (road-like degree ~3)
+* tiled      copies of the campus graph side by side, stitched at their borders
+*
+* roads are two-way unless picked as one-way (probability --oneway, random direction);
+* lengths are the haversine distance times a 0-10% detour, so A* stays admissible
+*/
+
+#define CENTER_LAT 33.776
+#define CENTER_LON -84.397
+#define NODE_SPACING 80.0        // meters between neighbouring nodes
+#define GRID_JITTER 0.25         // of the spacing, per coordinate
+#define GRID_MISSING_STREET 0.05 // probability a grid edge is left out
+#define GEOMETRIC_NEIGHBOURS 3
+#define GEOMETRIC_MAX_CANDIDATES 64
+#define TILE_GAP 60.0            // meters between tiles
+#define TILE_STITCHES 4          // connections across each tile border
+#define DEFAULT_ONEWAY 0.1
+
+typedef struct {
+    FILE* edges;
+    double oneway;
+    long long num_edges;
+} EdgeWriter;
+
+/******************************************************
+ * Random numbers (splitmix64, same sequence on every platform)
+ ******************************************************/
+
+static uint64_t rng_state;
+
+static uint64_t rng_next(void) {
+    uint64_t z = (rng_state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [0, 1)
+static double rng_uniform(void) {
+    return (double)(rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/******************************************************
+ * Output
+ ******************************************************/
+
+static FILE* open_output(const char* dir, const char* name, const char* header) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "\033[31m:( Cannot write '%s'\033[0m\n", path);
+        return NULL;
+    }
+    setvbuf(f, NULL, _IOFBF, 1 << 20);
+    fprintf(f, "%s\n", header);
+    return f;
+}
+
+// One road between a and b: both directions, or one random direction for a one-way street
+static void write_road(EdgeWriter* w, const double* lat, const double* lon, int a, int b) {
+    double length = haversine(lat[a], lon[a], lat[b], lon[b]) * (1.0 + 0.1 * rng_uniform());
+    if (rng_uniform() < w->oneway) {
+        if (rng_uniform() < 0.5) {
+            int tmp = a;
+            a = b;
+            b = tmp;
+        }
+        fprintf(w->edges, "%d,%d,%.6f\n", a, b, length);
+        w->num_edges++;
+        return;
+    }
+    fprintf(w->edges, "%d,%d,%.6f\n%d,%d,%.6f\n", a, b, length, b, a, length);
+    w->num_edges += 2;
+}
+
+static void write_coordinates(FILE* f, const double* lat, const double* lon, int n) {
+    for (int i = 0; i < n; i++) fprintf(f, "%d,%.7f,%.7f\n", i, lon[i], lat[i]);
+}
+
+// num_buildings distinct random nodes named "Building <i>"
+static void write_random_buildings(FILE* f, int n, int num_buildings) {
+    if (num_buildings > n) num_buildings = n;
+    int* perm = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) perm[i] = i;
+    for (int i = 0; i < num_buildings; i++) {
+        int j = i + (int)(rng_next() % (uint64_t)(n - i));
+        int tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+        fprintf(f, "Building %d,%d\n", i + 1, perm[i]);
+    }
+    free(perm);
+}
+
+// Degrees per meter around the generated area
+static double deg_per_m_lat(void) { return 1.0 / 111320.0; }
+static double deg_per_m_lon(void) { return 1.0 / (111320.0 * cos(CENTER_LAT * M_PI / 180.0)); }
+
+/******************************************************
+ * Generators
+ ******************************************************/
+
+static void gen_grid(EdgeWriter* w, double* lat, double* lon, int n) {
+    int cols = (int)ceil(sqrt((double)n));
+    int rows = (n + cols - 1) / cols;
+    double dlat = NODE_SPACING * deg_per_m_lat(), dlon = NODE_SPACING * deg_per_m_lon();
+
+    for (int i = 0; i < n; i++) {
+        int r = i / cols, c = i % cols;
+        lat[i] = CENTER_LAT + (r - rows / 2.0 + GRID_JITTER * (2.0 * rng_uniform() - 1.0)) * dlat;
+        lon[i] = CENTER_LON + (c - cols / 2.0 + GRID_JITTER * (2.0 * rng_uniform() - 1.0)) * dlon;
+    }
+    for (int i = 0; i < n; i++) {
+        int c = i % cols;
+        if (c + 1 < cols && i + 1 < n && rng_uniform() >= GRID_MISSING_STREET) write_road(w, lat, lon, i, i + 1);
+        if (i + cols < n && rng_uniform() >= GRID_MISSING_STREET) write_road(w, lat, lon, i, i + cols);
+    }
+}
+
+// Indices of the k nearest other points to item i, fewer if none are left within reach
+static int nearest_neighbours(const SpatialGrid* grid, const double* lat, const double* lon, int n,
+                              int i, int k, int* out) {
+    int candidates[GEOMETRIC_MAX_CANDIDATES];
+    double radius = 1.5 * NODE_SPACING;
+    int found = 0;
+    // widen until k others are in range (or the area is exhausted)
+    for (int attempt = 0; attempt < 12; attempt++, radius *= 2) {
+        found = spatial_radius(grid, lat[i], lon[i], radius, candidates, GEOMETRIC_MAX_CANDIDATES);
+        if (found > GEOMETRIC_MAX_CANDIDATES) found = GEOMETRIC_MAX_CANDIDATES;
+        if (found > k || found >= n) break;
+    }
+
+    // partial selection sort by distance, skipping i itself
+    double best_dist[GEOMETRIC_NEIGHBOURS];
+    int count = 0;
+    for (int c = 0; c < found; c++) {
+        int j = candidates[c];
+        if (j == i) continue;
+        double d = haversine(lat[i], lon[i], lat[j], lon[j]);
+        int pos;
+        if (count < k) pos = count++;
+        else if (d < best_dist[k - 1]) pos = k - 1;
+        else continue;
+        while (pos > 0 && best_dist[pos - 1] > d) {
+            best_dist[pos] = best_dist[pos - 1];
+            out[pos] = out[pos - 1];
+            pos--;
+        }
+        best_dist[pos] = d;
+        out[pos] = j;
+    }
+    return count;
+}
+
+static void gen_geometric(EdgeWriter* w, double* lat, double* lon, int n) {
+    // square area with one point per NODE_SPACING^2 on average
+    double side = sqrt((double)n) * NODE_SPACING;
+    for (int i = 0; i < n; i++) {
+        lat[i] = CENTER_LAT + (rng_uniform() - 0.5) * side * deg_per_m_lat();
+        lon[i] = CENTER_LON + (rng_uniform() - 0.5) * side * deg_per_m_lon();
+    }
+
+    SpatialGrid* grid = spatial_grid_build(lat, lon, n, NODE_SPACING);
+    int k = GEOMETRIC_NEIGHBOURS;
+    int* knn = malloc(sizeof(int) * (size_t)n * k);
+    int* knn_count = malloc(sizeof(int) * n);
+    for (int i = 0; i < n; i++) knn_count[i] = nearest_neighbours(grid, lat, lon, n, i, k, knn + (size_t)i * k);
+    spatial_grid_free(grid);
+
+    // road i-j once: from the smaller id, or from i when j did not pick i back
+    for (int i = 0; i < n; i++) {
+        for (int a = 0; a < knn_count[i]; a++) {
+            int j = knn[(size_t)i * k + a];
+            int mutual = 0;
+            for (int b = 0; b < knn_count[j]; b++) mutual |= knn[(size_t)j * k + b] == i;
+            if (mutual && j < i) continue;
+            write_road(w, lat, lon, i, j);
+        }
+    }
+    free(knn);
+    free(knn_count);
+}
+
+// Mark the strongly connected component around the best connected node (forward and
+// backward BFS), so tiles are only stitched where every other tile node can be reached
+static unsigned char* main_component(const Graph* g) {
+    int n = g->num_nodes;
+    int root = 0;
+    for (int i = 1; i < n; i++) {
+        if (g->offsets[i + 1] - g->offsets[i] > g->offsets[root + 1] - g->offsets[root]) root = i;
+    }
+
+    unsigned char* seen = calloc(n, 1); // bit 0: reached forward, bit 1: backward
+    int* queue = malloc(sizeof(int) * n);
+    for (int dir = 0; dir < 2; dir++) {
+        const int* offsets = dir == 0 ? g->offsets : g->rev_offsets;
+        const int* adjacent = dir == 0 ? g->targets : g->rev_sources;
+        unsigned char bit = (unsigned char)(1 << dir);
+        int head = 0, tail = 0;
+        queue[tail++] = root;
+        seen[root] |= bit;
+        while (head < tail) {
+            int u = queue[head++];
+            for (int e = offsets[u]; e < offsets[u + 1]; e++) {
+                int v = adjacent[e];
+                if (seen[v] & bit) continue;
+                seen[v] |= bit;
+                queue[tail++] = v;
+            }
+        }
+    }
+    for (int i = 0; i < n; i++) seen[i] = seen[i] == 3;
+    free(queue);
+    return seen;
+}
+
+// The TILE_STITCHES marked nodes with the largest sign * key, largest first
+static void extreme_nodes(const double* key, const unsigned char* mask, int n, double sign, int* out) {
+    for (int s = 0; s < TILE_STITCHES; s++) out[s] = -1;
+    for (int i = 0; i < n; i++) {
+        if (!mask[i]) continue;
+        double v = sign * key[i];
+        int pos = TILE_STITCHES;
+        while (pos > 0 && (out[pos - 1] < 0 || sign * key[out[pos - 1]] < v)) pos--;
+        if (pos >= TILE_STITCHES) continue;
+        for (int s = TILE_STITCHES - 1; s > pos; s--) out[s] = out[s - 1];
+        out[pos] = i;
+    }
+}
+
+static int gen_tiled(EdgeWriter* w, FILE* buildings_out, const char* campus_dir,
+                     double** out_lat, double** out_lon, int* num_nodes, int target) {
+    char adj_path[4096], coord_path[4096], building_path[4096];
+    snprintf(adj_path, sizeof(adj_path), "%s/adj_list.csv", campus_dir);
+    snprintf(coord_path, sizeof(coord_path), "%s/node_coordinates.csv", campus_dir);
+    snprintf(building_path, sizeof(building_path), "%s/building_mapping.csv", campus_dir);
+
+    Graph* g = load_graph(adj_path);
+    if (!g) return -1;
+    if (load_node_coordinates(g, coord_path) != 0) {
+        free_graph(g);
+        return -1;
+    }
+    BuildingMapping* mapping = load_building(building_path);
+    if (!mapping) {
+        free_graph(g);
+        return -1;
+    }
+
+    int m = g->num_nodes;
+    double min_lat = DBL_MAX, max_lat = -DBL_MAX, min_lon = DBL_MAX, max_lon = -DBL_MAX;
+    for (int i = 0; i < m; i++) {
+        if (g->lat[i] < min_lat) min_lat = g->lat[i];
+        if (g->lat[i] > max_lat) max_lat = g->lat[i];
+        if (g->lon[i] < min_lon) min_lon = g->lon[i];
+        if (g->lon[i] > max_lon) max_lon = g->lon[i];
+    }
+    double step_lat = max_lat - min_lat + TILE_GAP * deg_per_m_lat();
+    double step_lon = max_lon - min_lon + TILE_GAP * deg_per_m_lon();
+
+    // enough whole tiles for target nodes, arranged close to a square
+    int tiles = (target + m - 1) / m;
+    if (tiles < 1) tiles = 1;
+    int cols = (int)ceil(sqrt((double)tiles));
+    int n = tiles * m;
+    double* lat = malloc(sizeof(double) * n);
+    double* lon = malloc(sizeof(double) * n);
+    for (int t = 0; t < tiles; t++) {
+        int r = t / cols, c = t % cols;
+        for (int i = 0; i < m; i++) {
+            lat[t * m + i] = g->lat[i] + r * step_lat;
+            lon[t * m + i] = g->lon[i] + c * step_lon;
+        }
+    }
+
+    // copy every edge as is, lengths included
+    for (int t = 0; t < tiles; t++) {
+        int base = t * m;
+        for (int u = 0; u < m; u++) {
+            for (int e = g->offsets[u]; e < g->offsets[u + 1]; e++) {
+                fprintf(w->edges, "%d,%d,%.6f\n", base + u, base + g->targets[e], g->weights[e]);
+            }
+        }
+        w->num_edges += g->num_edges;
+    }
+
+    // stitch tile borders: east edge to the west edge of the next column, north to south
+    int east[TILE_STITCHES], west[TILE_STITCHES], north[TILE_STITCHES], south[TILE_STITCHES];
+    unsigned char* connected = main_component(g);
+    extreme_nodes(g->lon, connected, m, 1.0, east);
+    extreme_nodes(g->lon, connected, m, -1.0, west);
+    extreme_nodes(g->lat, connected, m, 1.0, north);
+    extreme_nodes(g->lat, connected, m, -1.0, south);
+    free(connected);
+    for (int t = 0; t < tiles; t++) {
+        int c = t % cols;
+        for (int s = 0; s < TILE_STITCHES && east[s] >= 0; s++) {
+            if (c + 1 < cols && t + 1 < tiles) write_road(w, lat, lon, t * m + east[s], (t + 1) * m + west[s]);
+            if (t + cols < tiles) write_road(w, lat, lon, t * m + north[s], (t + cols) * m + south[s]);
+        }
+    }
+
+    // buildings keep their names in tile 0 and get a "(tile t)" suffix in the copies
+    for (int t = 0; t < tiles; t++) {
+        for (int b = 0; b < mapping->count; b++) {
+            if (t == 0) fprintf(buildings_out, "%s,%d\n", mapping->entries[b].name, mapping->entries[b].node_id);
+            else fprintf(buildings_out, "%s (tile %d),%d\n", mapping->entries[b].name, t, t * m + mapping->entries[b].node_id);
+        }
+    }
+
+    free_building(mapping);
+    free_graph(g);
+    *out_lat = lat;
+    *out_lon = lon;
+    *num_nodes = n;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 4) {
+        fprintf(stderr, "Usage: %s <grid|geometric|tiled> <nodes> <out_dir> [--seed=<s>] [--oneway=<p>] "
+                        "[--buildings=<n>] [--campus=<dir>]\n", argv[0]);
+        return 1;
+    }
+    const char* kind = argv[1];
+    long target = strtol(argv[2], NULL, 10);
+    const char* out_dir = argv[3];
+    if (target < 2 || target > 100000000) {
+        fprintf(stderr, "\033[31m:( Node count must be between 2 and 10^8\033[0m\n");
+        return 1;
+    }
+
+    unsigned long long seed = 1;
+    double oneway = DEFAULT_ONEWAY;
+    long num_buildings = -1;
+    const char* campus_dir = "data";
+    for (int i = 4; i < argc; i++) {
+        if (strncmp(argv[i], "--seed=", 7) == 0) seed = strtoull(argv[i] + 7, NULL, 10);
+        else if (strncmp(argv[i], "--oneway=", 9) == 0) oneway = atof(argv[i] + 9);
+        else if (strncmp(argv[i], "--buildings=", 12) == 0) num_buildings = strtol(argv[i] + 12, NULL, 10);
+        else if (strncmp(argv[i], "--campus=", 9) == 0) campus_dir = argv[i] + 9;
+        else {
+            fprintf(stderr, "\033[31m:( Unknown option '%s'\033[0m\n", argv[i]);
+            return 1;
+        }
+    }
+    if (strcmp(kind, "grid") != 0 && strcmp(kind, "geometric") != 0 && strcmp(kind, "tiled") != 0) {
+        fprintf(stderr, "\033[31m:( Unknown graph kind '%s'\033[0m\n", kind);
+        return 1;
+    }
+    rng_state = seed;
+
+    FILE* edges = open_output(out_dir, "adj_list.csv", "src,dst,length");
+    FILE* coords = edges ? open_output(out_dir, "node_coordinates.csv", "node_id,x,y") : NULL;
+    FILE* buildings = coords ? open_output(out_dir, "building_mapping.csv", "building_name,node_id") : NULL;
+    if (!buildings) {
+        if (edges) fclose(edges);
+        if (coords) fclose(coords);
+        return 1;
+    }
+
+    EdgeWriter writer = {edges, oneway, 0};
+    double* lat = NULL;
+    double* lon = NULL;
+    int n = (int)target;
+    int status = 0;
+
+    if (strcmp(kind, "tiled") == 0) {
+        // the copies keep the campus one-way streets; --oneway only applies to the stitches
+        status = gen_tiled(&writer, buildings, campus_dir, &lat, &lon, &n, (int)target);
+    } else {
+        lat = malloc(sizeof(double) * n);
+        lon = malloc(sizeof(double) * n);
+        if (strcmp(kind, "grid") == 0) gen_grid(&writer, lat, lon, n);
+        else gen_geometric(&writer, lat, lon, n);
+        // default: one building per hundred nodes, at least enough for an 18-stop TSP
+        if (num_buildings < 0) num_buildings = n / 100 > 18 ? n / 100 : 18;
+        write_random_buildings(buildings, n, (int)num_buildings);
+    }
+    if (status == 0) write_coordinates(coords, lat, lon, n);
+
+    int failed = fclose(edges) != 0;
+    failed |= fclose(coords) != 0;
+    failed |= fclose(buildings) != 0;
+    if (status == 0 && !failed) {
+        fprintf(stderr, "\033[32m:) Wrote %s graph to '%s' (%d nodes, %lld edges, seed %llu)\033[0m\n",
+                kind, out_dir, n, writer.num_edges, seed);
+    }
+    free(lat);
+    free(lon);
+    return status == 0 && !failed ? 0 : 1;
+}